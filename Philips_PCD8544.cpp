@@ -3,59 +3,168 @@
 
 /*
  * Name         :  LcdInit
- * Description  :  Performs MCU LCD controller initialization.
+ * Description  :  Performs MCU LCD controller initialization. Blocks until
+ *                 initStep() completes; see initStep() for a non-blocking
+ *                 alternative.
  * Argument(s)  :  None.
  * Return value :  None.
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::init ( void ) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::init ( void ) {
+    initBegin();
+    while( ! initStep() );
+}
+
+/*
+ * Name         :  initStep
+ * Description  :  Advances the initialization state machine by one step.
+ *                 Never blocks: reset timing is measured against Clock_t,
+ *                 and the display RAM is cleared one bank per step.
+ *                 Call repeatedly (e.g. from a Process) until it returns true.
+ * Argument(s)  :  None.
+ * Return value :  true once the controller is initialized.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> bool Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::initStep ( void ) {
+    switch( initState ){
+    case INIT_START:
 /*
-    // Pull-up on reset pin.
-    LCD_RST_pin.enable_pullup();
+        // Pull-up on reset pin.
+        LCD_RST_pin.enable_pullup();
 */
+        /* Disable LCD controller */
+        LCD_CE_pin.set_output_high();
+
+        /* Assert display reset. The datasheet requires this within 30ms of
+           power-on, so there is no leading delay. */
+        LCD_RST_pin.set_output_low();
+        initTime = clock.now();
+        initState = INIT_RESET;
+        return false;
+
+    case INIT_RESET: {
+        /* Hold reset for at least RESET_PULSE_US. One extra tick is
+           required, as initTime may have been sampled just before a tick. */
+        typename Clock_t::Time_t elapsed = clock.now() - initTime;
+        if( elapsed <= ( RESET_PULSE_US + Clock_t::TICK_US - 1 ) / Clock_t::TICK_US )
+            return false;
+        LCD_RST_pin.set_output_high();
+        initState = INIT_CONFIGURE;
+        return false;
+    }
 
-    Delay();
-
-    /* Toggle display reset pin. */
-    LCD_RST_pin.set_output_low();
-    Delay();
-    LCD_RST_pin.set_output_high();
-
-    /* Disable LCD controller */
-    LCD_CE_pin.set_output_high();
+    case INIT_CONFIGURE:
+        /* The controller has just been reset. */
+        invalidateState();
+        commandCount = 0;
 
-    send( 0x21, LCD_CMD ); /* LCD Extended Commands. */
-    send( 0xC8, LCD_CMD ); /* Set LCD Vop (Contrast).*/
-    send( 0x06, LCD_CMD ); /* Set Temp coefficent. */
-    send( 0x13, LCD_CMD ); /* LCD bias mode 1:48. */
-    send( 0x20, LCD_CMD ); /* LCD Standard Commands,Horizontal addressing mode */
-    send( 0x0C, LCD_CMD ); /* LCD in normal mode. */
+        contrast( 0x48 );                 /* Set LCD Vop (Contrast). */
+        tempCoeff( 2 );                   /* Set Temp coefficent. */
+        bias( 3 );                        /* LCD bias mode 1:48. */
+        setDisplayControl( currentDisplayMode ); /* LCD in normal mode, unless set otherwise. */
 
-    /* Reset watermark pointers to empty */
-    LoWaterMark = CACHE_SIZE;
-    HiWaterMark = 0;
+        /* Clear display on first time use */
+        bandBase = 0;
+        topBank = 0;
+        memset(screenCache.data(),0x00,BAND_SIZE);
+        CacheIdx = 0;
+        setAddress( 0 );
+        flushCommands();
+        initBank = 0;
+        initState = INIT_CLEAR;
+        return false;
+
+    case INIT_CLEAR: {
+        /* Clear one bank of display RAM per step; the address counter
+           advances into the next bank by itself. */
+        beginTransfer();
+        for ( byte i = 0; i < X_RES; i++ )
+            transfer( 0x00, LCD_DATA );
+        endTransfer();
+        if( ++initBank < ( Y_RES / 8 ) )
+            return false;
+
+        /* Nothing left to update */
+        clearDirty();
+        updateActive = FALSE;
+        initState = INIT_DONE;
+        return true;
+    }
 
-    /* Clear display on first time use */
-    clear();
-    update();
+    default:
+        return true;
+    }
 }
 
 /*
  * Name         :  LcdContrast
- * Description  :  Set display contrast.
+ * Description  :  Set display contrast. Nothing is sent if the contrast is
+ *                 unchanged. The basic instruction set is selected again
+ *                 in the same burst, so that send() keeps working.
  * Argument(s)  :  contrast -> Contrast value from 0x00 to 0x7F.
  * Return value :  None.
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::contrast ( byte contrast ) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::contrast ( byte contrast ) {
   DEBUGprint_FORCE("L.C:%d;", contrast);
 
-    /* LCD Extended Commands. */
-    send( 0x21, LCD_CMD );
+    contrast &= 0x7F;
+    if ( contrast != vop ) {
+        /* Set LCD contrast level. */
+        selectInstructionSet( true );
+        queueCommand( 0x80 | contrast );
+        vop = contrast;
+        selectInstructionSet( false );
+    }
+    flushCommands();
+}
 
-    /* Set LCD contrast level. */
-    send( 0x80 | contrast, LCD_CMD );
+/*
+ * Name         :  tempCoeff
+ * Description  :  Set temperature coefficient. Nothing is sent if unchanged.
+ * Argument(s)  :  coefficient -> Temperature coefficient from 0 to 3.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::tempCoeff ( byte coefficient ) {
+    coefficient &= 0x03;
+    if ( coefficient != tempCoefficient ) {
+        selectInstructionSet( true );
+        queueCommand( 0x04 | coefficient );
+        tempCoefficient = coefficient;
+        selectInstructionSet( false );
+    }
+    flushCommands();
+}
 
-    /* LCD Standard Commands, horizontal addressing mode. */
-    send( 0x20, LCD_CMD );
+/*
+ * Name         :  bias
+ * Description  :  Set bias system. Nothing is sent if unchanged.
+ * Argument(s)  :  bias -> Bias system from 0 to 7 (3 is 1:48).
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::bias ( byte bias ) {
+    bias &= 0x07;
+    if ( bias != biasSystem ) {
+        selectInstructionSet( true );
+        queueCommand( 0x10 | bias );
+        biasSystem = bias;
+        selectInstructionSet( false );
+    }
+    flushCommands();
+}
+
+/*
+ * Name         :  displayMode
+ * Description  :  Blanks, inverts or lights the whole display without
+ *                 rewriting display RAM, so that e.g. flashing an alert
+ *                 costs a command byte or two per toggle. Nothing is sent
+ *                 if the mode is unchanged. The mode is kept across init.
+ * Argument(s)  :  mode -> Display mode. See enum.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::displayMode ( DisplayMode mode ) {
+    currentDisplayMode = mode;
+    /* Before configuration, init applies it. */
+    if ( initState <= INIT_CONFIGURE ) return;
+    setDisplayControl( mode );
+    flushCommands();
 }
 
 /*
@@ -65,16 +174,65 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  * Return value :  None.
  * Note         :  Based on Sylvain Bissonette's code
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::clear ( void ) {
-    memset(screenCache,0x00,CACHE_SIZE);
-    /* Reset watermark pointers to full */
-    LoWaterMark = 0;
-    HiWaterMark = CACHE_SIZE - 1;
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::clear ( void ) {
+    memset(screenCache.data(),0x00,BAND_SIZE);
+    topBank = 0;
+    /* Mark every bank dirty */
+    memset( dirtyLo, 0x00, BANKS );
+    memset( dirtyHi, X_RES - 1, BANKS );
 
     /* Set update flag to be true */
     updateActive = TRUE;
 }
 
+/*
+ * Name         :  scrollBanks
+ * Description  :  Scrolls the screen up by whole banks, clearing the banks
+ *                 uncovered at the bottom. The cache rows are a ring, so
+ *                 no bytes move in RAM. The controller cannot scroll, so
+ *                 update must resend the rows that change on the display;
+ *                 only the columns that actually differ are marked.
+ *                 The cursor is not moved. update must be called next.
+ * Argument(s)  :  banks -> Number of banks (8 pixel rows) to scroll by.
+ * Return value :  see return value on pcd8544.h (OUT_OF_BORDER if banded)
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::scrollBanks ( byte banks ) {
+    byte bank, x1, x2;
+
+    if ( BAND_BANKS < BANKS )
+        return OUT_OF_BORDER;
+    if ( banks == 0 )
+        return OK;
+    if ( banks >= BANKS ) {
+        clear();
+        return OK;
+    }
+
+    /*  Each bank takes the contents of the bank below it, or zeros. The
+        display still shows the old contents, except where the bank was
+        already dirty, so mark the columns where old and new differ. */
+    for ( bank = 0; bank < BANKS; bank++ ) {
+        const byte *shown = bankPtr( bank );
+        const byte *next = bank + banks < BANKS ? bankPtr( bank + banks ) : NULL;
+
+        for ( x1 = 0; x1 < X_RES; x1++ )
+            if ( shown[ x1 ] != ( next ? next[ x1 ] : 0x00 ) ) break;
+        if ( x1 == X_RES ) continue;
+        for ( x2 = X_RES - 1; x2 > x1; x2-- )
+            if ( shown[ x2 ] != ( next ? next[ x2 ] : 0x00 ) ) break;
+        markDirty( bank, x1, x2 );
+    }
+
+    /* Rotate the ring; the old top banks become the cleared bottom ones. */
+    topBank += banks;
+    if ( topBank >= BANKS ) topBank -= BANKS;
+    for ( bank = BANKS - banks; bank < BANKS; bank++ )
+        memset( bankPtr( bank ), 0x00, X_RES );
+
+    updateActive = TRUE;
+    return OK;
+}
+
 /*
  * Name         :  gotoXYFont
  * Description  :  Sets cursor location to xy location corresponding to basic
@@ -83,7 +241,7 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  * Return value :  see return value in pcd8544.h
  * Note         :  Based on Sylvain Bissonette's code
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::gotoXYFont ( byte x, byte y ) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::gotoXYFont ( byte x, byte y ) {
     /* Boundary check, slow down the speed but will guarantee this code wont fail */
     if( x > MAX_X_FONT)
         return OUT_OF_BORDER;
@@ -103,15 +261,11 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  *                 ch   -> Character to write.
  * Return value :  see pcd8544.h about return value
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::chr ( LcdFontSize size, byte ch ) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::chr ( LcdFontSize size, byte ch ) {
     byte i, c;
     byte b1, b2;
     CacheIndex_t  tmpIdx;
-
-    if ( CacheIdx < LoWaterMark ){
-        /* Update low marker. */
-        LoWaterMark = CacheIdx;
-    }
+    CacheIndex_t  startIdx = CacheIdx;
 
     if ( (ch < 0x20) || (ch > 0x7b) ){
         /* Convert to a printable character. */
@@ -121,18 +275,16 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
     if ( size == FONT_1X ){
         for ( i = 0; i < 5; i++ ) {
             /* Copy lookup table from Flash ROM to screenCache */
-            screenCache[CacheIdx++] = get_font_byte(ch - 32, i) << 1;
+            cacheByte(CacheIdx++) = get_font_byte(ch - 32, i) << 1;
         }
     }else if ( size == FONT_2X ){
-        if(CacheIdx < 84){
-          LoWaterMark = 0;
+        if(CacheIdx < 84)
           return OUT_OF_BORDER;
-        }
 
         tmpIdx = CacheIdx - 84;
 
-        if ( tmpIdx < LoWaterMark )
-            LoWaterMark = tmpIdx;
+        /* Upper half goes into the bank above. */
+        setMinimumWaterMarks( tmpIdx, tmpIdx + 9 );
 
         for ( i = 0; i < 5; i++ ) {
             /* Copy lookup table from Flash ROM to temporary c */
@@ -152,10 +304,10 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
             b2 |= (c & 0x08) * 24;
 
             /* Copy two parts into screenCache */
-            screenCache[tmpIdx++] = b1;
-            screenCache[tmpIdx++] = b1;
-            screenCache[tmpIdx + 82] = b2;
-            screenCache[tmpIdx + 83] = b2;
+            cacheByte(tmpIdx++) = b1;
+            cacheByte(tmpIdx++) = b1;
+            cacheByte(tmpIdx + 82) = b2;
+            cacheByte(tmpIdx + 83) = b2;
         }
 
         /* Update x cursor position. */
@@ -163,14 +315,12 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
         CacheIdx = (CacheIdx + 11) % CACHE_SIZE;
     }
 
-    if ( CacheIdx > HiWaterMark ){
-        /* Update high marker. */
-        HiWaterMark = CacheIdx;
-    }
+    /* Mark the character and its gap for update. */
+    setMinimumWaterMarks( startIdx, CacheIdx );
 
     /* Horizontal gap between characters. */
     /* Version 0.2.5 - Possible bug fixed on Dec 25,2008 */
-    screenCache[CacheIdx] = 0x00;
+    cacheByte(CacheIdx) = 0x00;
     /* At index number CACHE_SIZE - 1, wrap to 0 */
     if(CacheIdx == (CACHE_SIZE - 1) ) {
         CacheIdx = 0;
@@ -191,7 +341,7 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  *                              into screenCache.
  * Return value :  see return value on pcd8544.h
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::str ( LcdFontSize size, byte dataArray[] ) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::str ( LcdFontSize size, byte dataArray[] ) {
     byte tmpIdx=0;
     byte response;
     while( dataArray[ tmpIdx ] != '\0' ){
@@ -220,7 +370,7 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  * Example      :  fStr(FONT_1X, PSTR("Hello World"));
  *                 fStr(FONT_1X, &name_of_string_as_array);
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::fStr ( LcdFontSize size, const byte *dataPtr ) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::fStr ( LcdFontSize size, const byte *dataPtr ) {
     byte c;
     byte response;
     for ( c = pgm_read_byte( dataPtr ); c; ++dataPtr, c = pgm_read_byte( dataPtr ) ) {
@@ -241,20 +391,26 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  * Return value :  see return value on pcd8544.h
  * Note         :  Based on Sylvain Bissonette's code
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::pixel ( byte x, byte y, PixelMode mode ) {
-    CacheIndex_t  index;
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::pixel ( byte x, byte y, PixelMode mode ) {
+    byte  *bank;
     byte  offset;
     byte  data;
 
     /* Prevent from getting out of border */
-    if ( x > X_RES ) return OUT_OF_BORDER;
-    if ( y > Y_RES ) return OUT_OF_BORDER;
+    if ( x >= X_RES ) return OUT_OF_BORDER;
+    if ( y >= Y_RES ) return OUT_OF_BORDER;
+
+    /* Mark for update. */
+    markDirty( y / 8, x, x );
 
-    /* Recalculating index and offset */
-    index = ( ( y / 8 ) * 84 ) + x;
+    /* Outside the current band: nothing to draw. */
+    bank = bankPtr( y / 8 );
+    if ( bank == NULL ) return OK;
+
+    /* Recalculating offset */
     offset  = y - ( ( y / 8 ) * 8 );
 
-    data = screenCache[ index ];
+    data = bank[ x ];
 
     /* Bit processing */
 
@@ -271,15 +427,7 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
         data ^= ( 0x01 << offset );
 
     /* Final result copied to screenCache */
-    screenCache[ index ] = data;
-
-    if ( index < LoWaterMark )
-        /*  Update low marker. */
-        LoWaterMark = index;
-
-    if ( index > HiWaterMark )
-        /*  Update high marker. */
-        HiWaterMark = index;
+    bank[ x ] = data;
 
     return OK;
 }
@@ -292,7 +440,7 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  *                 mode   -> Off, On or Xor. See enum in pcd8544.h.
  * Return value :  see return value on pcd8544.h
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::line ( byte x1, byte x2, byte y1, byte y2, PixelMode mode ) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::line ( byte x1, byte x2, byte y1, byte y2, PixelMode mode ) {
     int dx, dy, stepx, stepy, fraction;
     byte response;
 
@@ -379,13 +527,13 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  *				   mode   -> Off, On or Xor. See enum in pcd8544.h.
  * Return value :  see return value on pcd8544.h
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::singleBar ( byte baseX, byte baseY, byte height, byte width, PixelMode mode ) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::singleBar ( byte baseX, byte baseY, byte height, byte width, PixelMode mode ) {
 	byte tmpIdxX,tmpIdxY,tmp;
 
     byte response;
 
-    /* Checking border */
-	if ( ( baseX > X_RES ) || ( baseY > Y_RES ) ) return OUT_OF_BORDER;
+    /* Checking border (baseY is the row below the bar) */
+	if ( ( baseX >= X_RES ) || ( baseY > Y_RES ) ) return OUT_OF_BORDER;
 
 	if ( height > baseY )
 		tmp = 0;
@@ -415,15 +563,17 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  *				   width  -> width of bar (in pixel)
  * Return value :  see return value on pcd8544.h
  * Note         :  Please check EMPTY_SPACE_BARS, BAR_X, BAR_Y in pcd8544.h
+ *                 Redraws every bar, and never clears shrinking ones; see
+ *                 BarGraph in Philips_PCD8544_Widgets.hpp for frequent updates.
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::bars ( byte data[], byte numbBars, byte width, byte multiplier ) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::bars ( byte data[], byte numbBars, byte width, byte multiplier ) {
     byte b;
     byte tmpIdx = 0;
     byte response;
 
     for ( b = 0;  b < numbBars ; b++ ) {
         /* Preventing from out of border (X_RES) */
-      if ( tmpIdx > X_RES ) return OUT_OF_BORDER;
+      if ( tmpIdx >= X_RES ) return OUT_OF_BORDER;
 
       /* Calculate x axis */
       tmpIdx = ((width + EMPTY_SPACE_BARS) * b) + BAR_X;
@@ -440,7 +590,9 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
 }
 /*
  * Name         :  rect
- * Description  :  Display a rectangle.
+ * Description  :  Display a filled rectangle, covering x1..x2-1 and y1..y2-1.
+ *                 Filled a bank at a time with byte masks; only the covered
+ *                 columns of the covered banks are marked for update.
  * Argument(s)  :  x1   -> absolute first x axis coordinate
  *                 y1   -> absolute first y axis coordinate
  *				   x2   -> absolute second x axis coordinate
@@ -448,9 +600,8 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  *				   mode -> Off, On or Xor. See enum in pcd8544.h.
  * Return value :  see return value on pcd8544.h.
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::rect ( byte x1, byte x2, byte y1, byte y2, PixelMode mode ) {
-	byte tmpIdxX,tmpIdxY;
-    byte response;
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::rect ( byte x1, byte x2, byte y1, byte y2, PixelMode mode ) {
+    byte bank, top, bottom, mask;
 
 	/* Checking border */
 	if ( ( x1 > X_RES ) ||  ( x2 > X_RES ) || ( y1 > Y_RES ) || ( y2 > Y_RES ) )
@@ -458,14 +609,13 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
 		return OUT_OF_BORDER;
 
 	if ( ( x2 > x1 ) && ( y2 > y1 ) ) {
-		for ( tmpIdxY = y1; tmpIdxY < y2; tmpIdxY++ ) {
-			/* Draw line horizontally */
-			for ( tmpIdxX = x1; tmpIdxX < x2; tmpIdxX++ ) {
-				/* Draw a pixel */
-				response = pixel( tmpIdxX, tmpIdxY, mode );
-                if(response)
-                    return response;
-            }
+		/* Fill one bank at a time, 8 rows per byte. */
+		for ( bank = y1 / 8; bank <= ( y2 - 1 ) / 8; bank++ ) {
+			top    = ( y1 > bank * 8 ) ? y1 - bank * 8 : 0;
+			bottom = ( y2 < bank * 8 + 8 ) ? y2 - bank * 8 : 8;
+			mask   = ( 0xFF << top ) & ( 0xFF >> ( 8 - bottom ) );
+			fillBankSpan( bank, x1, x2, mask, mode );
+			markDirty( bank, x1, x2 - 1 );
 		}
 
 		/* Set update flag to be true */
@@ -474,6 +624,374 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
     return OK;
 }
 
+/*
+ * Name         :  fillBankSpan
+ * Description  :  Applies a pixel mode to the masked rows of a run of
+ *                 columns within one bank. Does not mark them dirty.
+ * Argument(s)  :  bank   -> Bank (row of 8 pixels).
+ *                 x1, x2 -> Columns x1 up to (not including) x2.
+ *                 mask   -> Rows to change within the bank (bit 0 is top).
+ *                 mode   -> Off, On or Xor. See enum in pcd8544.h.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::fillBankSpan ( byte bank, byte x1, byte x2, byte mask, PixelMode mode ) {
+    byte *data = bankPtr( bank );
+    if ( data == NULL ) return;
+    data += x1;
+    byte *end  = data + ( x2 - x1 );
+
+    if ( mode == PIXEL_OFF ) {
+        mask = ~mask;
+        while ( data < end ) *data++ &= mask;
+    } else if ( mode == PIXEL_ON ) {
+        while ( data < end ) *data++ |= mask;
+    } else if ( mode == PIXEL_XOR ) {
+        while ( data < end ) *data++ ^= mask;
+    }
+}
+
+/*
+ * Name         :  circle, fillCircle, ellipse and fillEllipse
+ * Description  :  Display an outlined or filled circle or ellipse, drawn as
+ *                 column spans (8 rows per byte written). Parts beyond the
+ *                 screen are clipped. Radii above 127 are reduced to 127.
+ * Argument(s)  :  xc, yc -> Absolute pixel coordinates of the centre.
+ *                 r      -> Radius (circle).
+ *                 rx, ry -> Horizontal and vertical radii (ellipse).
+ *                 mode   -> Off, On or Xor. See enum in pcd8544.h.
+ * Return value :  see return value on pcd8544.h
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::circle ( byte xc, byte yc, byte r, PixelMode mode ) {
+    return ellipse( xc, yc, r, r, mode );
+}
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::fillCircle ( byte xc, byte yc, byte r, PixelMode mode ) {
+    return fillEllipse( xc, yc, r, r, mode );
+}
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::ellipse ( byte xc, byte yc, byte rx, byte ry, PixelMode mode ) {
+    ArcRange full;
+    if ( ( xc > X_RES ) || ( yc > Y_RES ) ) return OUT_OF_BORDER;
+    full.active = false;
+    ellipseSpans( xc, yc, rx, ry, mode, false, full );
+    return OK;
+}
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::fillEllipse ( byte xc, byte yc, byte rx, byte ry, PixelMode mode ) {
+    ArcRange full;
+    if ( ( xc > X_RES ) || ( yc > Y_RES ) ) return OUT_OF_BORDER;
+    full.active = false;
+    ellipseSpans( xc, yc, rx, ry, mode, true, full );
+    return OK;
+}
+
+/*
+ * Name         :  arc and fillArc
+ * Description  :  Display part of a circle's outline (arc), or a filled
+ *                 sector (fillArc). Angles are in degrees, anticlockwise
+ *                 from the positive x axis; equal angles give a full circle.
+ * Argument(s)  :  xc, yc     -> Absolute pixel coordinates of the centre.
+ *                 r          -> Radius.
+ *                 start, end -> Angles bounding the arc.
+ *                 mode       -> Off, On or Xor. See enum in pcd8544.h.
+ * Return value :  see return value on pcd8544.h
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::arc ( byte xc, byte yc, byte r, int16_t start, int16_t end, PixelMode mode ) {
+    ArcRange range;
+    if ( ( xc > X_RES ) || ( yc > Y_RES ) ) return OUT_OF_BORDER;
+    setArcRange( range, start, end );
+    ellipseSpans( xc, yc, r, r, mode, false, range );
+    return OK;
+}
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::fillArc ( byte xc, byte yc, byte r, int16_t start, int16_t end, PixelMode mode ) {
+    ArcRange range;
+    if ( ( xc > X_RES ) || ( yc > Y_RES ) ) return OUT_OF_BORDER;
+    setArcRange( range, start, end );
+    ellipseSpans( xc, yc, r, r, mode, true, range );
+    return OK;
+}
+
+/*
+ * Name         :  polygon and fillPolygon
+ * Description  :  Display a closed polygon outline, or fill a convex
+ *                 polygon. Both are built a column at a time from the
+ *                 Bresenham runs of the edges (see edgeColumnRun): the
+ *                 outline is their union, so every pixel is changed once
+ *                 and Xor mode is exact, and the fill spans from the top
+ *                 to the bottom of them, so it always covers the outline.
+ * Argument(s)  :  xs, ys -> Absolute pixel coordinates of the vertices.
+ *                 count  -> Number of vertices.
+ *                 mode   -> Off, On or Xor. See enum in pcd8544.h.
+ * Return value :  see return value on pcd8544.h
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::polygon ( const byte xs[], const byte ys[], byte count, PixelMode mode ) {
+    return polygonSpans( xs, ys, count, mode, false );
+}
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::fillPolygon ( const byte xs[], const byte ys[], byte count, PixelMode mode ) {
+    return polygonSpans( xs, ys, count, mode, true );
+}
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::polygonSpans ( const byte xs[], const byte ys[], byte count, PixelMode mode, bool filled ) {
+    byte i, bank, edges, minX = 0xFF, maxX = 0, minY = 0xFF, maxY = 0;
+    byte masks[ BANKS ];
+    int16_t x, top, bottom, yTop, yBottom;
+
+    for ( i = 0; i < count; i++ ) {
+        if ( ( xs[ i ] > X_RES ) || ( ys[ i ] > Y_RES ) ) return OUT_OF_BORDER;
+        if ( xs[ i ] < minX ) minX = xs[ i ];
+        if ( xs[ i ] > maxX ) maxX = xs[ i ];
+        if ( ys[ i ] < minY ) minY = ys[ i ];
+        if ( ys[ i ] > maxY ) maxY = ys[ i ];
+    }
+    if ( count == 0 ) return OK;
+    if ( maxX >= X_RES ) maxX = X_RES - 1;
+
+    /* Two vertices make one segment, not two overlapping ones. */
+    edges = ( count == 2 ) ? 1 : count;
+
+    for ( x = minX; x <= maxX; x++ ) {
+        memset( masks, 0x00, BANKS );
+        yTop = Y_RES;
+        yBottom = -1;
+        for ( i = 0; i < edges; i++ ) {
+            byte next = ( i + 1 < count ) ? i + 1 : 0;
+            if ( ! edgeColumnRun( xs[ i ], ys[ i ], xs[ next ], ys[ next ], x, top, bottom ) )
+                continue;
+            if ( bottom >= Y_RES ) bottom = Y_RES - 1;
+            if ( top > bottom ) continue;
+            if ( top < yTop ) yTop = top;
+            if ( bottom > yBottom ) yBottom = bottom;
+            if ( ! filled )
+                for ( ; top <= bottom; top++ )
+                    masks[ top >> 3 ] |= 1 << ( top & 7 );
+        }
+        if ( yTop > yBottom ) continue;
+
+        if ( filled )
+            columnSpan( x, yTop, yBottom, mode );
+        else
+            for ( bank = yTop >> 3; bank <= ( yBottom >> 3 ); bank++ )
+                if ( masks[ bank ] )
+                    fillBankSpan( bank, x, x + 1, masks[ bank ], mode );
+    }
+
+    markDirtyRect( minX, maxX, minY, maxY );
+    updateActive = TRUE;
+    return OK;
+}
+
+/*
+ * Name         :  ellipseSpans
+ * Description  :  Rasterises an ellipse column by column from the half
+ *                 height h of each column offset dx: the largest h with
+ *                 dx^2 ry^2 + h^2 rx^2 <= rx^2 ry^2 (1 + 1 / max(rx, ry)).
+ *                 The outline of a column runs from h down to one above
+ *                 the next column's h, so steep sides have no gaps.
+ * Argument(s)  :  xc, yc -> Centre.
+ *                 rx, ry -> Radii.
+ *                 mode   -> Off, On or Xor. See enum in pcd8544.h.
+ *                 filled -> Fill rather than outline.
+ *                 arc    -> Angular range to keep, if active.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::ellipseSpans ( int16_t xc, int16_t yc, byte rx, byte ry, PixelMode mode, bool filled, const ArcRange &arc ) {
+    if ( rx > 127 ) rx = 127;
+    if ( ry > 127 ) ry = 127;
+
+    uint32_t rx2 = (uint32_t) rx * rx;
+    uint32_t ry2 = (uint32_t) ry * ry;
+    uint32_t limit = rx2 * ry2;
+    if ( rx || ry )
+        limit += limit / ( rx > ry ? rx : ry );
+
+    int16_t h = ry, next, lo;
+    for ( int16_t dx = 0; dx <= rx; dx++ ) {
+        /* Half height of the next column. */
+        next = -1;
+        if ( dx < rx ) {
+            next = h;
+            while ( next >= 0 && ( (uint32_t) ( dx + 1 ) * ( dx + 1 ) * ry2 + (uint32_t) next * next * rx2 ) > limit )
+                next--;
+        }
+
+        lo = filled ? 0 : next + 1;
+        if ( lo > h ) lo = h;
+
+        for ( int16_t side = ( dx ? -1 : 1 ); side <= 1; side += 2 ) {
+            if ( lo <= 0 )
+                arcColumnSpan( xc, yc, side * dx, -h, h, mode, arc );
+            else {
+                arcColumnSpan( xc, yc, side * dx, -h, -lo, mode, arc );
+                arcColumnSpan( xc, yc, side * dx, lo, h, mode, arc );
+            }
+        }
+        h = next;
+    }
+
+    markDirtyRect( xc - rx, xc + rx, yc - ry, yc + ry );
+    updateActive = TRUE;
+}
+
+/*
+ * Name         :  setArcRange
+ * Description  :  Prepares the direction vectors bounding an arc.
+ * Argument(s)  :  arc        -> Range to set.
+ *                 start, end -> Angles in degrees, anticlockwise from +x.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::setArcRange ( ArcRange &arc, int16_t start, int16_t end ) {
+    int16_t sweep = ( end - start ) % 360;
+    if ( sweep < 0 ) sweep += 360;
+
+    arc.active = ( sweep != 0 );
+    arc.wide   = ( sweep > 180 );
+    arc.startX = sine127( start + 90 );
+    arc.startY = sine127( start );
+    arc.endX   = sine127( end + 90 );
+    arc.endY   = sine127( end );
+}
+
+/*
+ * Name         :  arcColumnSpan
+ * Description  :  Draws the span dy1..dy2 of column offset dx from the
+ *                 centre, keeping only the runs inside the arc's angles.
+ * Argument(s)  :  xc, yc   -> Centre.
+ *                 dx       -> Column offset.
+ *                 dy1, dy2 -> Row offsets (screen orientation, inclusive).
+ *                 mode     -> Off, On or Xor. See enum in pcd8544.h.
+ *                 arc      -> Angular range, if active.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::arcColumnSpan ( int16_t xc, int16_t yc, int16_t dx, int16_t dy1, int16_t dy2, PixelMode mode, const ArcRange &arc ) {
+    if ( ! arc.active ) {
+        columnSpan( xc + dx, yc + dy1, yc + dy2, mode );
+        return;
+    }
+
+    int16_t runStart = 0;
+    bool inRun = false;
+    for ( int16_t dy = dy1; dy <= dy2; dy++ ) {
+        /* Angles run anticlockwise with y up, so flip dy. Inside when
+           start x p >= 0 and p x end >= 0 (or, past 180 degrees, when not
+           strictly inside the complementary arc). */
+        int16_t px = dx, py = -dy;
+        bool inside;
+        if ( arc.wide )
+            inside = ! ( ( arc.endX * py - arc.endY * px ) > 0 && ( px * arc.startY - py * arc.startX ) > 0 );
+        else
+            inside = ( arc.startX * py - arc.startY * px ) >= 0 && ( px * arc.endY - py * arc.endX ) >= 0;
+
+        if ( inside && ! inRun ) {
+            runStart = dy;
+            inRun = true;
+        } else if ( ! inside && inRun ) {
+            columnSpan( xc + dx, yc + runStart, yc + dy - 1, mode );
+            inRun = false;
+        }
+    }
+    if ( inRun )
+        columnSpan( xc + dx, yc + runStart, yc + dy2, mode );
+}
+
+/*
+ * Name         :  edgeColumnRun
+ * Description  :  Finds the rows a line (Bresenham, drawn from its start)
+ *                 covers in one column. The line is walked from its start
+ *                 until it leaves the column, so that every caller sees
+ *                 exactly the same pixels.
+ * Argument(s)  :  x1, y1      -> Start.
+ *                 x2, y2      -> End.
+ *                 x           -> Column.
+ *                 top, bottom -> Set to the first and last row covered.
+ * Return value :  false if the line does not reach the column.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> bool Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::edgeColumnRun ( int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x, int16_t &top, int16_t &bottom ) {
+    if ( ( x < x1 && x < x2 ) || ( x > x1 && x > x2 ) ) return false;
+
+    int16_t dx = ( x2 > x1 ) ? x2 - x1 : x1 - x2;
+    int16_t dy = ( y2 > y1 ) ? y1 - y2 : y2 - y1;
+    int16_t stepx = ( x2 > x1 ) ? 1 : -1;
+    int16_t stepy = ( y2 > y1 ) ? 1 : -1;
+    int16_t error = dx + dy, e2;
+    bool found = false;
+
+    for ( ;; ) {
+        if ( x1 == x ) {
+            if ( ! found ) {
+                top = bottom = y1;
+                found = true;
+            } else if ( y1 < top )
+                top = y1;
+            else if ( y1 > bottom )
+                bottom = y1;
+        } else if ( found )
+            /* Left the column; x only moves one way. */
+            break;
+        if ( x1 == x2 && y1 == y2 ) break;
+
+        e2 = 2 * error;
+        if ( e2 >= dy ) { error += dy; x1 += stepx; }
+        if ( e2 <= dx ) { error += dx; y1 += stepy; }
+    }
+    return found;
+}
+
+/*
+ * Name         :  columnSpan
+ * Description  :  Applies a pixel mode to rows y1..y2 of column x, one
+ *                 byte mask per bank. Clipped to the screen; not marked dirty.
+ * Argument(s)  :  x      -> Column.
+ *                 y1, y2 -> First and last row.
+ *                 mode   -> Off, On or Xor. See enum in pcd8544.h.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::columnSpan ( int16_t x, int16_t y1, int16_t y2, PixelMode mode ) {
+    if ( x < 0 || x >= X_RES ) return;
+    if ( y1 < 0 ) y1 = 0;
+    if ( y2 >= Y_RES ) y2 = Y_RES - 1;
+    if ( y1 > y2 ) return;
+
+    for ( byte bank = y1 >> 3; bank <= ( y2 >> 3 ); bank++ ) {
+        byte top    = ( bank == ( y1 >> 3 ) ) ? ( y1 & 7 ) : 0;
+        byte bottom = ( bank == ( y2 >> 3 ) ) ? ( y2 & 7 ) + 1 : 8;
+        fillBankSpan( bank, x, x + 1, ( 0xFF << top ) & ( 0xFF >> ( 8 - bottom ) ), mode );
+    }
+}
+
+/*
+ * Name         :  markDirtyRect
+ * Description  :  Marks a rectangle (inclusive, clipped) for update.
+ * Argument(s)  :  x1, x2 -> First and last column.
+ *                 y1, y2 -> First and last row.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::markDirtyRect ( int16_t x1, int16_t x2, int16_t y1, int16_t y2 ) {
+    if ( x1 < 0 ) x1 = 0;
+    if ( x2 >= X_RES ) x2 = X_RES - 1;
+    if ( y1 < 0 ) y1 = 0;
+    if ( y2 >= Y_RES ) y2 = Y_RES - 1;
+    if ( x1 > x2 || y1 > y2 ) return;
+
+    for ( byte bank = y1 >> 3; bank <= ( y2 >> 3 ); bank++ )
+        markDirty( bank, x1, x2 );
+}
+
+/*
+ * Name         :  setMinimumWaterMarks
+ * Description  :  Marks a range of the cache for the next update().
+ * Argument(s)  :  new_LoWaterMark -> First cache index.
+ *                 new_HiWaterMark -> Last cache index (inclusive).
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::setMinimumWaterMarks(const CacheIndex_t new_LoWaterMark, const CacheIndex_t new_HiWaterMark) {
+    CacheIndex_t hi = new_HiWaterMark;
+    if ( hi >= CACHE_SIZE ) hi = CACHE_SIZE - 1;
+    if ( new_LoWaterMark > hi ) return;
+
+    byte loBank = new_LoWaterMark / X_RES;
+    byte hiBank = hi / X_RES;
+    for ( byte bank = loBank; bank <= hiBank; bank++ )
+        markDirty( bank,
+                   ( bank == loBank ) ? new_LoWaterMark % X_RES : 0,
+                   ( bank == hiBank ) ? hi % X_RES : X_RES - 1 );
+}
+
 /*
  * Name         :  writeBitmap and writeBitmap_P
  * Description  :  Bitmap write routine. Writes at any desired offset.
@@ -482,14 +1000,15 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
  * Return value :  None.
  * Example      :  image(&sample_image_declared_as_array);
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::writeBitmap(const byte *imageData, const CacheIndex_t offset, CacheIndex_t size) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::writeBitmap(const byte *imageData, const CacheIndex_t offset, CacheIndex_t size) {
   // Sanity check
-    if(size > CACHE_SIZE) size = CACHE_SIZE;
+    if(offset >= CACHE_SIZE) return;
+    if(size > CACHE_SIZE - offset) size = CACHE_SIZE - offset;
 
   DEBUGprint_FORCE("Wbp:%d/%d;", offset, size);
 
   // Write bitmap to cache.
-    memcpy(screenCache + offset,imageData,size);
+    copyToCache(imageData, offset, size, false);
 
   /* Expand watermark pointers, if necessary. */
     setMinimumWaterMarks(offset, offset + size - 1);
@@ -497,12 +1016,13 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
   /* Set update pending semaphore. */
     updateActive = TRUE;
 }
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::writeBitmap_P(const byte *imageData, const CacheIndex_t offset, CacheIndex_t size) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::writeBitmap_P(const byte *imageData, const CacheIndex_t offset, CacheIndex_t size) {
   // Sanity check
-    if(size > CACHE_SIZE) size = CACHE_SIZE;
+    if(offset >= CACHE_SIZE) return;
+    if(size > CACHE_SIZE - offset) size = CACHE_SIZE - offset;
 
-  /* Initialize screenCache index to 0 */
-    memcpy_P(screenCache,imageData,size);
+  // Write bitmap to cache.
+    copyToCache(imageData, offset, size, true);
 
   /* Expand watermark pointers, if necessary. */
     setMinimumWaterMarks(offset, offset + size - 1);
@@ -511,60 +1031,433 @@ template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typen
     updateActive = TRUE;
 }
 
+/*
+ * Name         :  writeBitmapRows
+ * Description  :  Writes a row-major 1bpp image (as in PBM: each row is
+ *                 padded to whole bytes, leftmost pixel in the MSB) into
+ *                 the cache at any pixel position, 8x8 blocks at a time.
+ *                 Pixels beyond the screen edges are clipped. Only the
+ *                 covered span of each bank is marked for update.
+ * Argument(s)  :  imageData -> Image rows.
+ *                 x, y      -> Position of the top left pixel.
+ *                 width     -> Image width in pixels.
+ *                 height    -> Image height in pixels.
+ * Return value :  see return value on pcd8544.h
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::writeBitmapRows( const byte *imageData, byte x, byte y, byte width, byte height ) {
+    return copyRowsToCache( imageData, x, y, width, height, false );
+}
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::writeBitmapRows_P( const byte *imageData, byte x, byte y, byte width, byte height ) {
+    return copyRowsToCache( imageData, x, y, width, height, true );
+}
+
+/*
+ * Name         :  copyRowsToCache
+ * Description  :  Implements writeBitmapRows. Each group of 8 image rows is
+ *                 transposed into column bytes and merged, under a mask,
+ *                 into the one or two banks it straddles.
+ * Argument(s)  :  As writeBitmapRows.
+ *                 progmem -> Image is in program memory.
+ * Return value :  see return value on pcd8544.h
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> byte Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::copyRowsToCache( const byte *data, byte x, byte y, byte width, byte height, bool progmem ) {
+    byte rows[ 8 ], columns[ 8 ];
+    byte stride = ( width + 7 ) / 8;
+    byte shift = y & 7;
+
+    if ( x >= X_RES || y >= Y_RES ) return OUT_OF_BORDER;
+    /* Clip to the screen. */
+    if ( width > X_RES - x ) width = X_RES - x;
+    if ( height > Y_RES - y ) height = Y_RES - y;
+    if ( width == 0 || height == 0 ) return OK;
+
+    for ( byte row = 0; row < height; row += 8 ) {
+        byte count = height - row < 8 ? height - row : 8;
+        byte mask = 0xFF >> ( 8 - count );
+        byte bank = ( y + row ) >> 3;
+        byte *upper = bankPtr( bank );
+        byte *lower = ( shift && bank + 1 < BANKS ) ? bankPtr( bank + 1 ) : NULL;
+
+        for ( byte block = 0; block * 8 < width; block++ ) {
+            const byte *source = data + row * stride + block;
+            for ( byte r = 0; r < 8; r++, source += stride )
+                rows[ r ] = r < count ? ( progmem ? pgm_read_byte( source ) : *source ) : 0x00;
+            transpose8( rows, columns );
+
+            byte columnX = x + block * 8;
+            byte n = width - block * 8 < 8 ? width - block * 8 : 8;
+            for ( byte c = 0; c < n; c++, columnX++ ) {
+                byte bits = columns[ c ] & mask;
+                if ( upper )
+                    upper[ columnX ] = ( upper[ columnX ] & ~( mask << shift ) ) | ( bits << shift );
+                if ( lower )
+                    lower[ columnX ] = ( lower[ columnX ] & ~( mask >> ( 8 - shift ) ) ) | ( bits >> ( 8 - shift ) );
+            }
+        }
+    }
+
+    markDirtyRect( x, x + width - 1, y, y + height - 1 );
+    updateActive = TRUE;
+    return OK;
+}
+
+/*
+ * Name         :  copyToCache
+ * Description  :  Copies bytes into the cache a bank at a time, skipping
+ *                 banks outside the current band.
+ * Argument(s)  :  data    -> Source, in cache layout.
+ *                 offset  -> Cache index of the first byte.
+ *                 size    -> Number of bytes (must fit the screen).
+ *                 progmem -> Source is in program memory.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::copyToCache(const byte *data, CacheIndex_t offset, CacheIndex_t size, bool progmem) {
+    while ( size ) {
+        byte bank = offset / X_RES;
+        byte x = offset % X_RES;
+        CacheIndex_t count = X_RES - x;
+        if ( count > size ) count = size;
+
+        byte *dest = bankPtr( bank );
+        if ( dest != NULL ) {
+            if ( progmem )
+                memcpy_P( dest + x, data, count );
+            else
+                memcpy( dest + x, data, count );
+        }
+        data += count;
+        offset += count;
+        size -= count;
+    }
+}
+
+/*
+ * Name         :  renderBands
+ * Description  :  Draws and sends a whole frame in bands of BAND_BANKS
+ *                 banks. For each band the cache is cleared, render() is
+ *                 called to draw the whole frame (drawing is clipped to the
+ *                 band), and the band is streamed to the display. render()
+ *                 must draw the same frame each time and must not call
+ *                 update(). Retained widgets need the full cache. Drawing
+ *                 outside renderBands is discarded by update().
+ * Argument(s)  :  render  -> Draws the frame.
+ *                 context -> Passed through to render().
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::renderBands( Render_t render, void *context ) {
+    /* Each frame is drawn from scratch, so the scroll ring can be reset. */
+    topBank = 0;
+    for ( bandBase = 0; bandBase < BANKS; bandBase += BAND_BANKS ) {
+        byte banks = BANKS - bandBase;
+        if ( banks > BAND_BANKS ) banks = BAND_BANKS;
+
+        memset( screenCache.data(), 0x00, BAND_SIZE );
+        CacheIdx = 0;
+        render( *this, context );
+
+        /* Bands are contiguous, so only the first needs addressing. */
+        setAddress( bandBase * X_RES );
+        beginTransfer();
+        const byte *data = screenCache.data();
+        for ( CacheIndex_t i = 0; i < banks * X_RES; i++ )
+            transfer( data[ i ], LCD_DATA );
+        endTransfer();
+    }
+    bandBase = 0;
+
+    clearDirty();
+    updateActive = FALSE;
+}
+
+/*
+ * Name         :  writeDirect
+ * Description  :  Streams bytes straight into display RAM in one burst,
+ *                 without passing through screenCache. The cache is not
+ *                 updated, so that range of it no longer matches the display.
+ * Argument(s)  :  data   -> Bytes to send, in cache layout.
+ *                 offset -> Cache index of the first byte.
+ *                 size   -> Number of bytes.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::writeDirect(const byte *data, const CacheIndex_t offset, CacheIndex_t size) {
+  // Sanity check
+    if(offset >= CACHE_SIZE) return;
+    if(size > CACHE_SIZE - offset) size = CACHE_SIZE - offset;
+
+    setAddress( offset );
+    beginTransfer();
+    while ( size-- )
+        transfer( *data++, LCD_DATA );
+    endTransfer();
+}
+
+/*
+ * Name         :  writeThrough
+ * Description  :  Streams bytes straight into display RAM in one burst,
+ *                 storing each into screenCache as it is sent, so the data
+ *                 is handled once and no update is needed for it. Dirty
+ *                 spans covered by the write are trimmed; the rest of the
+ *                 screen is left for the next update. Banks outside the
+ *                 current band are sent but not cached.
+ * Argument(s)  :  data   -> Bytes to send, in cache layout.
+ *                 offset -> Cache index of the first byte.
+ *                 size   -> Number of bytes.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::writeThrough(const byte *data, const CacheIndex_t offset, CacheIndex_t size) {
+  // Sanity check
+    if(offset >= CACHE_SIZE) return;
+    if(size > CACHE_SIZE - offset) size = CACHE_SIZE - offset;
+
+    byte bank = offset / X_RES;
+    byte x = offset % X_RES;
+
+    setAddress( offset );
+    beginTransfer();
+    while ( size ) {
+        byte count = X_RES - x;
+        if ( count > size ) count = size;
+        byte last = x + count - 1;
+
+        byte *dest = bankPtr( bank );
+        if ( dest != NULL ) {
+            dest += x;
+            for ( byte i = 0; i < count; i++ )
+                transfer( *dest++ = *data++, LCD_DATA );
+
+            /* The display now matches the cache over x..last. */
+            if ( x <= dirtyLo[ bank ] && last >= dirtyHi[ bank ] ) {
+                dirtyLo[ bank ] = 0xFF;
+                dirtyHi[ bank ] = 0x00;
+            } else if ( x <= dirtyLo[ bank ] && last >= dirtyLo[ bank ] )
+                dirtyLo[ bank ] = last + 1;
+            else if ( x <= dirtyHi[ bank ] && last >= dirtyHi[ bank ] )
+                dirtyHi[ bank ] = x - 1;
+        } else {
+            for ( byte i = 0; i < count; i++ )
+                transfer( *data++, LCD_DATA );
+        }
+
+        size -= count;
+        bank++;
+        x = 0;
+    }
+    endTransfer();
+}
+
 /*
  * Name         :  update
  * Description  :  Copies the LCD screenCache into the device RAM.
+ *                 In banded mode the cache holds whichever band was drawn
+ *                 last, not the banks the dirty marks refer to, so only
+ *                 queued commands are sent and drawing is discarded; use
+ *                 renderBands (or writeThrough) to change the display.
  * Argument(s)  :  None.
  * Return value :  None.
  */
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::update ( void ) {
-    CacheIndex_t i;
-  // LoWaterMark is unsigned, so lower boundary of 0 is innately enforced.
-    if ( LoWaterMark >= CACHE_SIZE )
-        LoWaterMark = CACHE_SIZE - 1;
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::update ( void ) {
+    byte bank;
+    bool selected = false;
 
-    if ( HiWaterMark >= CACHE_SIZE )
-        HiWaterMark = CACHE_SIZE - 1;
+    DEBUGprint_FORCE("Lu;");
 
-    DEBUGprint_FORCE("Lu:%d/%d;", LoWaterMark, HiWaterMark);
+    if ( BAND_BANKS < BANKS ) {
+        flushCommands();
+        clearDirty();
+        updateActive = FALSE;
+        return;
+    }
 
-    /*  Set base address according to LoWaterMark. */
-    send( 0x80 | ( LoWaterMark % X_RES ), LCD_CMD );
-    send( 0x40 | ( LoWaterMark / X_RES ), LCD_CMD );
+    /*  Serialize each bank's dirty span, all in one burst. The address is
+        only set where the counter is not already there, so spans that
+        continue from the previous one cost no commands. */
+    for ( bank = 0; bank < BANKS; bank++ ) {
+        if ( dirtyLo[ bank ] > dirtyHi[ bank ] ) continue;
+        const byte *data = bankPtr( bank );
+
+        setAddress( bank * X_RES + dirtyLo[ bank ] );
+        if ( ! selected ) {
+            beginTransfer();
+            selected = true;
+        } else
+            drainCommands();
+
+        const byte *end  = data + dirtyHi[ bank ];
+        data += dirtyLo[ bank ];
+        while ( data <= end )
+            transfer( *data++, LCD_DATA );
+    }
 
-    /*  Serialize the display buffer. */
-    for ( i = LoWaterMark; i <= HiWaterMark; i++ )
-        send( screenCache[ i ], LCD_DATA );
+    if ( selected )
+        endTransfer();
+    else
+        /*  Nothing to serialize; just send any queued commands. */
+        flushCommands();
 
-    /*  Reset watermark pointers. */
-    LoWaterMark = CACHE_SIZE - 1;
-    HiWaterMark = 0;
+    clearDirty();
 
     /* Set update flag to be true */
     updateActive = FALSE;
 }
 
+/*
+ * Name         :  collectDirty
+ * Description  :  Passes each bank's dirty span to span() in screen order,
+ *                 instead of sending it, then marks the cache clean. This
+ *                 lets a driver with no bus serve as a drawing surface for
+ *                 another that owns the display (see writeThrough).
+ * Argument(s)  :  span    -> Receives the cache index, bytes and length.
+ *                 context -> Passed through to span().
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::collectDirty( Span_t span, void *context ) {
+    /* Banded: nothing but renderBands can send the cache; see update. */
+    for ( byte bank = 0; bank < BANKS && BAND_BANKS == BANKS; bank++ ) {
+        if ( dirtyLo[ bank ] > dirtyHi[ bank ] ) continue;
+        const byte *data = bankPtr( bank );
+        span( context, bank * X_RES + dirtyLo[ bank ], data + dirtyLo[ bank ], dirtyHi[ bank ] - dirtyLo[ bank ] + 1 );
+    }
+    clearDirty();
+    updateActive = FALSE;
+}
+
 /*
  * Name         :  send
- * Description  :  Sends data to display controller.
+ * Description  :  Sends data to display controller, framed on its own.
+ *                 Bytes are passed through untouched, so raw command
+ *                 sequences such as 0x21, 0x80 | vop, 0x20 work as before.
+ *                 A function set command is tracked; any other command
+ *                 makes the driver forget the rest of the controller state.
  * Argument(s)  :  data -> Data to be sent
  *                 cd   -> Command or data (see enum in pcd8544.h)
  * Return value :  None.
  */
 // Was static
-template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES>::send ( byte data, LcdCmdData cd ) {
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::send ( byte data, LcdCmdData cd ) {
+    beginTransfer();
+    transfer( data, cd );
+    endTransfer();
+
+    if ( cd == LCD_CMD ) {
+        if ( ( data & 0xF8 ) == 0x20 )
+            functionSet = data;
+        else {
+            /* The instruction set is unchanged by any other command. */
+            byte instructionSet = functionSet;
+            invalidateState();
+            functionSet = instructionSet;
+        }
+    }
+}
+
+/*
+ * Name         :  queueCommand
+ * Description  :  Queues a command for the next burst, flushing if full.
+ * Argument(s)  :  command -> Command byte.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::queueCommand ( byte command ) {
+    if ( commandCount == COMMAND_QUEUE_SIZE )
+        flushCommands();
+    commandQueue[ commandCount++ ] = command;
+}
+
+/*
+ * Name         :  selectInstructionSet
+ * Description  :  Queues a function set command if the instruction set
+ *                 differs. Always uses horizontal addressing, powered up.
+ * Argument(s)  :  extended -> true for the extended instruction set (H=1).
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::selectInstructionSet ( bool extended ) {
+    byte command = extended ? 0x21 : 0x20;
+    if ( command == functionSet ) return;
+    queueCommand( command );
+    functionSet = command;
+}
+
+/*
+ * Name         :  setDisplayControl
+ * Description  :  Queues a display control command (0x08 | D | E) if it
+ *                 differs from the current display configuration.
+ * Argument(s)  :  command -> Display control command.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::setDisplayControl ( byte command ) {
+    if ( command == displayControl ) return;
+    selectInstructionSet( false );
+    queueCommand( command );
+    displayControl = command;
+}
+
+/*
+ * Name         :  setAddress
+ * Description  :  Queues X and/or Y address commands, skipping any that
+ *                 the address counter already satisfies.
+ * Argument(s)  :  index -> Cache index of the next byte to be written.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::setAddress ( CacheIndex_t index ) {
+    if ( index == addressCounter ) return;
+
+    byte x = index % X_RES;
+    byte y = index / X_RES;
+    bool known = ( addressCounter < CACHE_SIZE );
+
+    selectInstructionSet( false );
+    if ( ! known || ( addressCounter % X_RES ) != x )
+        queueCommand( 0x80 | x );
+    if ( ! known || ( addressCounter / X_RES ) != y )
+        queueCommand( 0x40 | y );
+    addressCounter = index;
+}
+
+/*
+ * Name         :  flushCommands
+ * Description  :  Sends all queued commands in one CE-framed burst.
+ * Argument(s)  :  None.
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::flushCommands ( void ) {
+    if ( commandCount == 0 ) return;
+    beginTransfer();
+    endTransfer();
+}
+
+/*
+ * Name         :  beginTransfer, drainCommands, transfer and endTransfer
+ * Description  :  A burst: beginTransfer enables the controller and sends
+ *                 the queued commands, drainCommands sends commands queued
+ *                 since, transfer sends further bytes, and endTransfer
+ *                 disables the controller.
+ * Argument(s)  :  data -> Data to be sent
+ *                 cd   -> Command or data (see enum in pcd8544.h)
+ * Return value :  None.
+ */
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::beginTransfer ( void ) {
     /*  Enable display controller (active low). */
     LCD_CE_pin.set_output_low();
 
-    if ( cd == LCD_DATA )
+    drainCommands();
+}
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::drainCommands ( void ) {
+    for ( uint8_t i = 0; i < commandCount; i++ )
+        transfer( commandQueue[ i ], LCD_CMD );
+    commandCount = 0;
+}
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::transfer ( byte data, LcdCmdData cd ) {
+    if ( cd == LCD_DATA ) {
         LCD_DC_pin.set_output_high();
-    else
+        /* Horizontal addressing: the counter advances, wrapping at the end of RAM. */
+        if ( addressCounter < CACHE_SIZE && ++addressCounter == CACHE_SIZE )
+            addressCounter = 0;
+    } else
         LCD_DC_pin.set_output_low();
 
     /*  Send data to display controller. */
     SPI_bus.transceive(data);
-
+}
+template<typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES, int Y_RES, typename Clock_t, int BAND_BANKS, typename Storage_t> void Philips_PCD8544<SPI_bus_t, LCD_DC_pin_t, LCD_CE_pin_t, LCD_RST_pin_t, X_RES, Y_RES, Clock_t, BAND_BANKS, Storage_t>::endTransfer ( void ) {
     /* Disable display controller. */
     LCD_CE_pin.set_output_high();
 }
-
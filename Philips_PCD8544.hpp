@@ -38,12 +38,129 @@ typedef enum {
     FONT_2X = 2
 } LcdFontSize;
 
+// Display control modes (0x08 | D | E). These act on the whole panel
+// without touching display RAM.
+typedef enum {
+    DISPLAY_BLANK   = 0x08,
+    DISPLAY_NORMAL  = 0x0C,
+    DISPLAY_ALL_ON  = 0x09,
+    DISPLAY_INVERSE = 0x0D
+} DisplayMode;
+
 uint8_t get_font_byte(uint8_t x, uint8_t y);
 
-// Architecture-specific delay routine.
-static void Delay ( void );
+// Sine of 0..90 degrees, scaled to 127. Used to orient arcs.
+static const uint8_t SineLookup [91] PROGMEM = {
+      0,   2,   4,   7,   9,  11,  13,  15,  18,  20,  22,  24,  26,  29,  31,  33,
+     35,  37,  39,  41,  43,  46,  48,  50,  52,  54,  56,  58,  60,  62,  63,  65,
+     67,  69,  71,  73,  75,  76,  78,  80,  82,  83,  85,  87,  88,  90,  91,  93,
+     94,  96,  97,  99, 100, 101, 103, 104, 105, 107, 108, 109, 110, 111, 112, 113,
+    114, 115, 116, 117, 118, 119, 119, 120, 121, 121, 122, 123, 123, 124, 124, 125,
+    125, 125, 126, 126, 126, 127, 127, 127, 127, 127, 127
+};
+
+// Sine of any angle in degrees, scaled to 127.
+inline int8_t sine127( int16_t degrees ){
+    degrees %= 360;
+    if ( degrees < 0 ) degrees += 360;
+    if ( degrees <= 90 )  return   pgm_read_byte( &SineLookup[ degrees ] );
+    if ( degrees <= 180 ) return   pgm_read_byte( &SineLookup[ 180 - degrees ] );
+    if ( degrees <= 270 ) return - pgm_read_byte( &SineLookup[ degrees - 180 ] );
+    return - pgm_read_byte( &SineLookup[ 360 - degrees ] );
+}
+
+// Transposes an 8x8 bit block: rows[r] is row r with its leftmost pixel in
+// the MSB (row-major 1bpp, as PBM); columns[c] receives column c with its
+// top pixel in the LSB (display RAM layout).
+inline void transpose8( const uint8_t rows[ 8 ], uint8_t columns[ 8 ] ){
+#if defined(__AVR__)
+    /* No barrel shifter: shift each row out MSB first. */
+    for ( uint8_t c = 0; c < 8; c++ ) columns[ c ] = 0;
+    for ( uint8_t r = 0; r < 8; r++ ) {
+        uint8_t b = rows[ r ];
+        for ( uint8_t c = 0; c < 8; c++ ) {
+            columns[ c ] = ( columns[ c ] >> 1 ) | ( b & 0x80 );
+            b <<= 1;
+        }
+    }
+#elif __SIZEOF_POINTER__ >= 8
+    /* Hacker's Delight transpose8, in one 64-bit word. Rows are loaded
+       bottom first, so that the top row lands in each column's LSB. */
+    uint64_t x = 0, t;
+    for ( int8_t r = 7; r >= 0; r-- ) x = ( x << 8 ) | rows[ r ];
+    t = ( x ^ ( x >> 7 ) )  & 0x00AA00AA00AA00AAULL; x ^= t ^ ( t << 7 );
+    t = ( x ^ ( x >> 14 ) ) & 0x0000CCCC0000CCCCULL; x ^= t ^ ( t << 14 );
+    t = ( x ^ ( x >> 28 ) ) & 0x00000000F0F0F0F0ULL; x ^= t ^ ( t << 28 );
+    for ( int8_t c = 7; c >= 0; c-- ) { columns[ c ] = x; x >>= 8; }
+#else
+    /* Hacker's Delight transpose8, in two 32-bit halves. */
+    uint32_t x = ( (uint32_t) rows[ 7 ] << 24 ) | ( (uint32_t) rows[ 6 ] << 16 ) | ( rows[ 5 ] << 8 ) | rows[ 4 ];
+    uint32_t y = ( (uint32_t) rows[ 3 ] << 24 ) | ( (uint32_t) rows[ 2 ] << 16 ) | ( rows[ 1 ] << 8 ) | rows[ 0 ];
+    uint32_t t;
+    t = ( x ^ ( x >> 7 ) )  & 0x00AA00AA; x ^= t ^ ( t << 7 );
+    t = ( y ^ ( y >> 7 ) )  & 0x00AA00AA; y ^= t ^ ( t << 7 );
+    t = ( x ^ ( x >> 14 ) ) & 0x0000CCCC; x ^= t ^ ( t << 14 );
+    t = ( y ^ ( y >> 14 ) ) & 0x0000CCCC; y ^= t ^ ( t << 14 );
+    t = ( x & 0xF0F0F0F0 ) | ( ( y >> 4 ) & 0x0F0F0F0F );
+    y = ( ( x << 4 ) & 0xF0F0F0F0 ) | ( y & 0x0F0F0F0F );
+    columns[ 0 ] = t >> 24; columns[ 1 ] = t >> 16; columns[ 2 ] = t >> 8; columns[ 3 ] = t;
+    columns[ 4 ] = y >> 24; columns[ 5 ] = y >> 16; columns[ 6 ] = y >> 8; columns[ 7 ] = y;
+#endif
+}
+
+// Architecture-specific default clock, used to time the reset sequence.
+// A Clock_t must provide:
+//   typedef <unsigned integer> Time_t;
+//   static const uint16_t TICK_US;   (Microseconds per tick.)
+//   Time_t now();                    (Free-running, wraps.)
+class DefaultClock;
+
+// Screen cache storage policies. A Storage_t provides byte *data(), at least
+// BAND_SIZE bytes, which must be valid from init() on.
+
+// Buffer inside the driver object (the default).
+template <uint16_t SIZE>
+class InternalStorage {
+  byte buffer[ SIZE ];
+public:
+  byte *data(){ return buffer; }
+};
+
+// Buffer owned by the caller, e.g. placed in a particular memory section or
+// shared with a receive buffer. Attach it before init().
+class ExternalStorage {
+  byte *buffer;
+public:
+  ExternalStorage( byte *new_buffer = NULL ) : buffer(new_buffer) { }
+  void attach( byte *new_buffer ){ buffer = new_buffer; }
+  byte *data(){ return buffer; }
+};
+
+// Cache buffers shared by several panels. Panels bound to the same slot
+// must not be drawn at the same time, and must redraw from clear() after
+// another panel has used the slot.
+template <uint16_t SIZE, uint8_t SLOTS>
+class FramePool {
+  byte buffers[ SLOTS ][ SIZE ];
+public:
+  byte *slot( uint8_t index ){ return buffers[ index ]; }
+};
+
+// A slot of a FramePool. Bind it before init().
+template <typename Pool_t>
+class PoolStorage {
+  Pool_t *pool;
+  uint8_t index;
+public:
+  PoolStorage() : pool(NULL), index(0) { }
+  void bind( Pool_t *new_pool, uint8_t new_index ){ pool = new_pool; index = new_index; }
+  byte *data(){ return pool->slot( index ); }
+};
 
-template <typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES=84, int Y_RES=48>
+// BAND_BANKS below Y_RES / 8 selects banded rendering: only that many banks
+// of the screen are cached in RAM, and frames are drawn with renderBands().
+// Storage_t decides where those cached bytes live; see above.
+template <typename SPI_bus_t, typename LCD_DC_pin_t, typename LCD_CE_pin_t, typename LCD_RST_pin_t, int X_RES=84, int Y_RES=48, typename Clock_t=DefaultClock, int BAND_BANKS=Y_RES/8, typename Storage_t=InternalStorage<X_RES * BAND_BANKS> >
 class Philips_PCD8544 {
 private:
 // Architecture-specific hardware.
@@ -51,57 +168,207 @@ private:
    LCD_DC_pin_t LCD_DC_pin;
    LCD_CE_pin_t LCD_CE_pin;
   LCD_RST_pin_t LCD_RST_pin;
+        Clock_t clock;
 
 public:
   static const uint8_t MAX_X_FONT = X_RES / 6;
   static const uint8_t MAX_Y_FONT = Y_RES / 8;
 
-/* Cache size in bytes ( 84 * 48 ) / 8 = 504 bytes */
+/* Screen size in bytes ( 84 * 48 ) / 8 = 504 bytes. Cache indices span the whole screen. */
   static const uint16_t CACHE_SIZE = ( X_RES * Y_RES ) / 8;
+/* Display RAM is organised as banks of 8 pixel rows, one byte per column */
+  static const uint8_t BANKS = Y_RES / 8;
+  static const uint8_t BANK_SIZE = X_RES;
+/* Bytes of the screen actually held in SRAM (all of it, unless banded) */
+  static const uint16_t BAND_SIZE = X_RES * BAND_BANKS;
+
+// Draws a whole frame; see renderBands.
+  typedef void (*Render_t)( Philips_PCD8544 &lcd, void *context );
+// Receives one dirty span; see collectDirty.
+  typedef void (*Span_t)( void *context, CacheIndex_t offset, const byte *data, byte size );
 
 private:
-/* Cache buffer in SRAM 84*48 bits or 504 bytes */
-  byte screenCache[ CACHE_SIZE ];
+/* Cache buffer, 84*48 bits or 504 bytes (or the current band) */
+  Storage_t screenCache;
+/* First bank held in screenCache */
+  byte bandBase;
+/* Cache row holding the top bank of the screen; see scrollBanks */
+  byte topBank;
+/* Absorbs writes that fall outside the current band */
+  byte scratch;
+
+// Cache storage for a bank, or NULL when it lies outside the current band.
+  byte *bankPtr( byte bank ){
+    if ( BAND_BANKS < BANKS ) {
+      bank -= bandBase;
+      if ( bank >= BAND_BANKS ) return NULL;
+    } else {
+      bank += topBank;
+      if ( bank >= BANKS ) bank -= BANKS;
+    }
+    return screenCache.data() + bank * X_RES;
+  }
+// Cache byte at a screen index; outside the current band, a scratch byte.
+  byte &cacheByte( CacheIndex_t index ){
+    if ( BAND_BANKS < BANKS ) {
+      index -= bandBase * X_RES;
+      if ( index >= BAND_SIZE ) return scratch;
+    } else if ( topBank ) {
+      index += topBank * X_RES;
+      if ( index >= CACHE_SIZE ) index -= CACHE_SIZE;
+    }
+    return screenCache.data()[ index ];
+  }
+// Copy into the cache at a screen index, one bank at a time.
+  void copyToCache( const byte *data, CacheIndex_t offset, CacheIndex_t size, bool progmem );
+// Copy a row-major 1bpp image into the cache; see writeBitmapRows.
+  byte copyRowsToCache( const byte *data, byte x, byte y, byte width, byte height, bool progmem );
 
 // Modified to eliminate signedness [ANC 2010-04-24]
 /* Cache index */
   CacheIndex_t CacheIdx;
-/* Lower part of water mark */
-  CacheIndex_t LoWaterMark;
-/* Higher part of water mark */
-  CacheIndex_t HiWaterMark;
+/* Dirty span of each bank, as inclusive columns. Empty when lo > hi. */
+  byte dirtyLo[ BANKS ];
+  byte dirtyHi[ BANKS ];
+
+// Expand a bank's dirty span to include columns x1..x2.
+  void markDirty( byte bank, byte x1, byte x2 ){
+    if ( x1 < dirtyLo[ bank ] ) dirtyLo[ bank ] = x1;
+    if ( x2 > dirtyHi[ bank ] ) dirtyHi[ bank ] = x2;
+  }
+  void clearDirty( void ){
+    memset( dirtyLo, 0xFF, BANKS );
+    memset( dirtyHi, 0x00, BANKS );
+  }
+
+// Apply mode to the masked bits of columns x1..x2-1 of a bank. Does not mark dirty.
+  void fillBankSpan( byte bank, byte x1, byte x2, byte mask, PixelMode mode );
+
+// Span engine for shapes. Coordinates are signed and clipped to the screen;
+// spans are inclusive. Spans do not mark dirty; each shape marks its
+// bounding box once.
+  typedef struct {
+    bool   active;
+    bool   wide;          /* Sweep of more than 180 degrees */
+    int8_t startX, startY, endX, endY;
+  } ArcRange;
+  void columnSpan    ( int16_t x, int16_t y1, int16_t y2, PixelMode mode );
+  void arcColumnSpan ( int16_t xc, int16_t yc, int16_t dx, int16_t dy1, int16_t dy2, PixelMode mode, const ArcRange &arc );
+  void markDirtyRect ( int16_t x1, int16_t x2, int16_t y1, int16_t y2 );
+  void ellipseSpans  ( int16_t xc, int16_t yc, byte rx, byte ry, PixelMode mode, bool filled, const ArcRange &arc );
+  bool edgeColumnRun ( int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x, int16_t &top, int16_t &bottom );
+  byte polygonSpans  ( const byte xs[], const byte ys[], byte count, PixelMode mode, bool filled );
+  static void setArcRange( ArcRange &arc, int16_t start, int16_t end );
 
 /* Variable to decide whether update Lcd Cache is active/nonactive */
   bool updateActive;
 
+// Initialization state machine (see initStep).
+  typedef enum {
+    INIT_START,
+    INIT_RESET,
+    INIT_CONFIGURE,
+    INIT_CLEAR,
+    INIT_DONE
+  } InitState;
+  byte initState;
+// Bank being cleared during INIT_CLEAR.
+  byte initBank;
+// Time at which the current init state was entered.
+  typename Clock_t::Time_t initTime;
+
+// Datasheet minimum RES low pulse width is 100ns; round up to a whole microsecond.
+  static const uint16_t RESET_PULSE_US = 1;
+
+// Controller state, as last sent. Commands that would not change it are skipped.
+  static const byte STATE_UNKNOWN = 0xFF;
+/* Last function set command (0x20 | PD | V | H) */
+  byte functionSet;
+/* Operating voltage (contrast), temperature coefficient and bias system values */
+  byte vop;
+  byte tempCoefficient;
+  byte biasSystem;
+/* Last display control command (0x08 | D | E) */
+  byte displayControl;
+/* Display mode requested by the application; applied again by init */
+  byte currentDisplayMode;
+/* Controller address counter, as a cache index. CACHE_SIZE when unknown. */
+  CacheIndex_t addressCounter;
+
+// Commands queued for the next CE-framed burst.
+  static const uint8_t COMMAND_QUEUE_SIZE = 8;
+  byte commandQueue[ COMMAND_QUEUE_SIZE ];
+  uint8_t commandCount;
+
+  void queueCommand        ( byte command );
+  void selectInstructionSet( bool extended );
+  void setDisplayControl   ( byte command );
+  void setAddress          ( CacheIndex_t index );
+  void beginTransfer       ( void );
+  void drainCommands       ( void );
+  void transfer            ( byte data, LcdCmdData cd );
+  void endTransfer         ( void );
 
 public:
   Philips_PCD8544(SPI_bus_t &new_SPI_bus, LCD_DC_pin_t &new_LCD_DC_pin, LCD_CE_pin_t &new_LCD_CE_pin, LCD_RST_pin_t &new_LCD_RST_pin)
-  : SPI_bus(new_SPI_bus), LCD_DC_pin(new_LCD_DC_pin), LCD_CE_pin(new_LCD_CE_pin), LCD_RST_pin(new_LCD_RST_pin)
-  { }
+  : SPI_bus(new_SPI_bus), LCD_DC_pin(new_LCD_DC_pin), LCD_CE_pin(new_LCD_CE_pin), LCD_RST_pin(new_LCD_RST_pin), bandBase(0), topBank(0), initState(INIT_START), currentDisplayMode(DISPLAY_NORMAL), commandCount(0)
+  { invalidateState(); }
+  Philips_PCD8544(SPI_bus_t &new_SPI_bus, LCD_DC_pin_t &new_LCD_DC_pin, LCD_CE_pin_t &new_LCD_CE_pin, LCD_RST_pin_t &new_LCD_RST_pin, Clock_t &new_clock)
+  : SPI_bus(new_SPI_bus), LCD_DC_pin(new_LCD_DC_pin), LCD_CE_pin(new_LCD_CE_pin), LCD_RST_pin(new_LCD_RST_pin), clock(new_clock), bandBase(0), topBank(0), initState(INIT_START), currentDisplayMode(DISPLAY_NORMAL), commandCount(0)
+  { invalidateState(); }
 // When the pin and SPI bus objects are stateless, use this constructor.
   Philips_PCD8544()
-  { }
+  : bandBase(0), topBank(0), initState(INIT_START), currentDisplayMode(DISPLAY_NORMAL), commandCount(0)
+  { invalidateState(); }
+
+// Cache storage, e.g. to attach an ExternalStorage buffer before init().
+  Storage_t &storage( void ){ return screenCache; }
 
 /* Function prototypes */
   void send    ( byte data, LcdCmdData cd );
   void init       ( void );
+  bool initStep   ( void );
+  // Restart the initialization state machine (e.g. after a panel power cycle).
+  void initBegin  ( void ){ initState = INIT_START; }
+  bool initialized( void ){ return initState == INIT_DONE; }
   void clear      ( void );
+  byte scrollBanks( byte banks );
   void update     ( void );
 
+  // Send any queued commands as a single CE-framed burst.
+  void flushCommands( void );
+  // Forget tracked controller state, so that every setting is re-sent.
+  void invalidateState( void ){
+    functionSet = vop = tempCoefficient = biasSystem = displayControl = STATE_UNKNOWN;
+    addressCounter = CACHE_SIZE;
+  }
+
+  void renderBands( Render_t render, void *context );
+  // Hand the dirty spans to span() instead of sending them, and mark the cache clean.
+  void collectDirty( Span_t span, void *context );
+
   void writeBitmap(const byte *imageData, const CacheIndex_t offset = 0, CacheIndex_t size = CACHE_SIZE);
   // Program memory version.
   void writeBitmap_P(const byte *imageData, const CacheIndex_t offset = 0, CacheIndex_t size = CACHE_SIZE);
+  // Row-major 1bpp image (PBM layout, MSB leftmost, rows padded to whole bytes) at any pixel position.
+  byte writeBitmapRows  ( const byte *imageData, byte x, byte y, byte width, byte height );
+  // Program memory version.
+  byte writeBitmapRows_P( const byte *imageData, byte x, byte y, byte width, byte height );
+  // Stream straight to display RAM, bypassing (and staling) screenCache.
+  void writeDirect(const byte *data, const CacheIndex_t offset, CacheIndex_t size);
+  // Stream straight to display RAM, copying into screenCache in the same pass.
+  void writeThrough(const byte *data, const CacheIndex_t offset, CacheIndex_t size);
 
-  // Expand watermark pointers to new minimums.
-  void setMinimumWaterMarks(const CacheIndex_t new_LoWaterMark, const CacheIndex_t new_HiWaterMark){
-    if(new_LoWaterMark < LoWaterMark) LoWaterMark = new_LoWaterMark;
-    if(new_HiWaterMark > HiWaterMark) HiWaterMark = new_HiWaterMark;
-  }
+  // Mark the cache index range new_LoWaterMark..new_HiWaterMark (inclusive) for update.
+  void setMinimumWaterMarks(const CacheIndex_t new_LoWaterMark, const CacheIndex_t new_HiWaterMark);
   // Historical alias.
   void image      ( const byte *imageData ){ writeBitmap_P(imageData); }
 
   void contrast   ( byte contrast );
+  void tempCoeff  ( byte coefficient );
+  void bias       ( byte bias );
+  void displayMode( DisplayMode mode );
+  DisplayMode displayMode( void ){ return (DisplayMode) currentDisplayMode; }
   byte gotoXYFont ( byte x, byte y );
   byte chr        ( LcdFontSize size, byte ch );
   byte str        ( LcdFontSize size, byte dataArray[] );
@@ -109,6 +376,14 @@ public:
   byte pixel      ( byte x, byte y, PixelMode mode );
   byte line       ( byte x1, byte x2, byte y1, byte y2, PixelMode mode );
   byte rect       ( byte x1, byte x2, byte y1, byte y2, PixelMode mode );
+  byte circle     ( byte xc, byte yc, byte r, PixelMode mode );
+  byte fillCircle ( byte xc, byte yc, byte r, PixelMode mode );
+  byte ellipse    ( byte xc, byte yc, byte rx, byte ry, PixelMode mode );
+  byte fillEllipse( byte xc, byte yc, byte rx, byte ry, PixelMode mode );
+  byte arc        ( byte xc, byte yc, byte r, int16_t start, int16_t end, PixelMode mode );
+  byte fillArc    ( byte xc, byte yc, byte r, int16_t start, int16_t end, PixelMode mode );
+  byte polygon    ( const byte xs[], const byte ys[], byte count, PixelMode mode );
+  byte fillPolygon( const byte xs[], const byte ys[], byte count, PixelMode mode );
   byte singleBar  ( byte baseX, byte baseY, byte height, byte width, PixelMode mode );
   byte bars       ( byte data[], byte numbBars, byte width, byte multiplier );
 };
@@ -0,0 +1,150 @@
+// Philips PCD8544 graphic LCD driver (C++).
+// Licensed under GPLv3. See license.txt or <http://www.gnu.org/licenses/>.
+
+// Packet handlers behind the servers in Philips_PCD8544_Server.hpp.
+// These depend only on the driver, so that captured traffic can be
+// replayed against them off-target (see tools/pcd8544_replay.cpp).
+
+#pragma once
+
+namespace Philips_PCD8544 {
+
+// CommandServer opcodes (first packet byte).
+typedef uint8_t Command_t;
+static const Command_t Command__ClearScreen = 0;
+static const Command_t Command__WriteBitmap = 1;
+static const Command_t Command__ReadBitmap  = 2;
+static const Command_t Command__SetContrast = 3;
+static const Command_t Command__WriteString = 4;
+static const Command_t Command__SetDisplayMode = 5;
+
+/*
+ * Name         :  handleStringPacket
+ * Description  :  Clears the screen and writes the packet contents out to
+ *                 it, beginning at the first row and performing a linefeed
+ *                 when the right edge of the screen is encountered.
+ * Argument(s)  :  lcd      -> Display.
+ *                 data_ptr -> First byte of packet data.
+ *                 end_ptr  -> One past the last byte of packet data.
+ * Return value :  None.
+ */
+template <typename LCD_t>
+void handleStringPacket(LCD_t *lcd, const uint8_t *data_ptr, const uint8_t *end_ptr){
+  // Clear screen
+  lcd->clear();
+
+  for(uint8_t Y = 1; Y <= LCD_t::MAX_Y_FONT; Y++){
+    // Start at leftmost edge of screen
+    lcd->gotoXYFont(1,Y);
+    while(data_ptr < end_ptr){
+      uint8_t response = lcd->chr(FONT_1X, *data_ptr);
+      if(response != OK){
+      // If wrapped, the character has actually been written.
+        if(response == OK_WITH_WRAP) data_ptr++;
+      // Move to next line
+        break;
+      }
+      // Move to next character
+      data_ptr++;
+    }
+  }
+
+  // Update screen
+  lcd->update();
+}
+
+/*
+ * Name         :  handleCommandPacket
+ * Description  :  Executes one CommandServer packet: an opcode followed by
+ *                 its arguments. Unrecognized commands are ignored.
+ * Argument(s)  :  lcd      -> Display.
+ *                 data_ptr -> First byte of packet data (the opcode).
+ *                 end_ptr  -> One past the last byte of packet data.
+ * Return value :  None.
+ */
+template <typename LCD_t>
+void handleCommandPacket(LCD_t *lcd, const uint8_t *data_ptr, const uint8_t *end_ptr){
+  DEBUGprint_FORCE("BmS:Oc%d;", *data_ptr);
+
+  switch(*data_ptr){
+  // Clear screen
+    case Command__ClearScreen:
+      lcd->clear();
+      lcd->update();
+     break;
+  // Write bitmap
+    case Command__WriteBitmap: {
+      data_ptr++;
+    // First byte is offset. Remaining data is actual image data.
+      // Assumes no more than 254 bitmap bytes per packet.
+      uint8_t packet_size = end_ptr - data_ptr;
+      // Only proceed if at least one byte is to be written. (Data starts at next byte.)
+      if(packet_size <= 1) break;
+      // Straight from the packet to the display; update sends anything else pending.
+      lcd->writeThrough(data_ptr + 1, *data_ptr, packet_size - 1);
+      lcd->update();
+     break;
+    }
+  // Read bitmap
+//    case Command__ReadBitmap:
+//     break;
+  // Set contrast
+    case Command__SetContrast: {
+    // First byte is new contrast.
+      data_ptr++;
+      uint8_t packet_size = end_ptr - data_ptr;
+      if(packet_size > 0)
+        lcd->contrast(*data_ptr);
+      lcd->update();
+     break;
+    }
+  // Set display mode
+    case Command__SetDisplayMode: {
+    // First byte is a DisplayMode value.
+      data_ptr++;
+      uint8_t packet_size = end_ptr - data_ptr;
+      if(packet_size == 0) break;
+      switch(*data_ptr){
+        case DISPLAY_BLANK:
+        case DISPLAY_NORMAL:
+        case DISPLAY_ALL_ON:
+        case DISPLAY_INVERSE:
+          lcd->displayMode((DisplayMode) *data_ptr);
+      }
+     break;
+    }
+  // Write string
+//    case Command__WriteString:
+//     break;
+  // Unrecognized commands are ignored.
+//    default:
+  }
+}
+
+/*
+ * Name         :  handleReadoutPacket
+ * Description  :  Shows one ReadoutServer packet on a NumericReadout:
+ *                 a count of binary fraction bits followed by a 1 to 4 byte
+ *                 big-endian two's complement value. With no fraction bits
+ *                 the value is shown as a count of 10^-decimals units.
+ * Argument(s)  :  readout  -> Readout widget (Philips_PCD8544_Widgets.hpp).
+ *                 data_ptr -> First byte of packet data.
+ *                 end_ptr  -> One past the last byte of packet data.
+ * Return value :  None.
+ */
+template <typename Readout_t>
+void handleReadoutPacket(Readout_t *readout, const uint8_t *data_ptr, const uint8_t *end_ptr){
+  if(end_ptr - data_ptr < 2 || end_ptr - data_ptr > 5) return;
+
+  uint8_t fractionBits = *data_ptr++;
+  // Sign-extend from the first value byte.
+  uint32_t value = (uint32_t) (int32_t) (int8_t) *data_ptr++;
+  while(data_ptr < end_ptr) value = (value << 8) | *data_ptr++;
+
+  if(fractionBits) readout->showFixed((int32_t) value, fractionBits);
+  else readout->show((int32_t) value);
+}
+
+// End namespace: Philips_PCD8544
+}
+
@@ -4,6 +4,10 @@
 #pragma once
 
 #include "Philips_PCD8544.hpp"
+#include "Philips_PCD8544_Commands.hpp"
+#include "Philips_PCD8544_Stream.hpp"
+#include "Philips_PCD8544_Trace.hpp"
+#include "Philips_PCD8544_Widgets.hpp"
 #include <Upacket/Servers/SimpleServer.hpp>
 
 /*
@@ -14,18 +18,43 @@
 
 namespace Philips_PCD8544{
 
+// Steps LCD initialization from the scheduler, so that several panels (and
+// the rest of the system) initialize in parallel instead of blocking in init().
 template <typename LCD_t>
-class StringServer : public SimpleServer, public Process {
+class InitProcess : public Process {
   LCD_t *lcd;
 
 public:
-  StringServer(LCD_t *new_lcd)
+  InitProcess(LCD_t *new_lcd)
   : lcd(new_lcd)
   { }
 
+Status::Status_t process(){
+  lcd->initStep();
+  return Status::Status__Good;
+}
+};
+
+// Servers optionally record the packets they receive (see
+// Philips_PCD8544_Trace.hpp). Pass a TraceRecorder as Trace_t to capture.
+// Servers draw and then update(), so they need the full screen cache. With
+// a banded driver, update() discards drawing; only contrast, display mode
+// and bitmap writes (which go straight to the display) take effect.
+template <typename LCD_t, typename Trace_t = NullTrace>
+class StringServer : public SimpleServer, public Process {
+  LCD_t *lcd;
+  Trace_t *trace;
+
+public:
+  StringServer(LCD_t *new_lcd, Trace_t *new_trace = NULL)
+  : lcd(new_lcd), trace(new_trace)
+  { }
+
 Status::Status_t process(){
   // Packet to process?
   if(! packetPending()) return Status::Status__Good;
+  // Leave packets queued until the display is ready.
+  if(! lcd->initialized()) return Status::Status__Good;
 
   DEBUGprint_MISC("SS: Prc pk\n");
 
@@ -33,123 +62,120 @@ Status::Status_t process(){
   MAP::Data_t *data_ptr = offsetPacket.packet->get_data(offsetPacket.headerOffset);
   if(data_ptr == NULL) return finishedWithPacket();
 
-  // Clear screen
-  lcd->clear();
-
-  // Write packet contents out to screen, beginning at first row and performing a linefeed
-  // when the right edge of the screen is encountered.
-  for(uint8_t Y = 1; Y <= LCD_t::MAX_Y_FONT; Y++){
-    // Start at leftmost edge of screen
-    lcd->gotoXYFont(1,Y);
-    while(data_ptr < offsetPacket.packet->back()){
-      uint8_t response = lcd->chr(FONT_1X, *data_ptr);
-      if(response != OK){
-      // If wrapped, the character has actually been written.
-        if(response == OK_WITH_WRAP) data_ptr++;
-      // Move to next line
-        break;
-      }
-      // Move to next character
-      data_ptr++;
-    }
-  }
-
-  // Update screen
-  lcd->update();
+  if(trace) trace->record(TRACE_STRING, data_ptr, offsetPacket.packet->back());
+  handleStringPacket(lcd, data_ptr, offsetPacket.packet->back());
 
   return finishedWithPacket();
 }
 };
 
-template <typename LCD_t>
+template <typename LCD_t, typename Trace_t = NullTrace>
 class CommandServer : public SimpleServer, public Process {
   LCD_t *lcd;
+  Trace_t *trace;
 
 public:
 
-  typedef uint8_t Command_t;
-  static const Command_t Command__ClearScreen = 0;
-  static const Command_t Command__WriteBitmap = 1;
-  static const Command_t Command__ReadBitmap  = 2;
-  static const Command_t Command__SetContrast = 3;
-  static const Command_t Command__WriteString = 4;
+  typedef ::Philips_PCD8544::Command_t Command_t;
+  static const Command_t Command__ClearScreen = ::Philips_PCD8544::Command__ClearScreen;
+  static const Command_t Command__WriteBitmap = ::Philips_PCD8544::Command__WriteBitmap;
+  static const Command_t Command__ReadBitmap  = ::Philips_PCD8544::Command__ReadBitmap;
+  static const Command_t Command__SetContrast = ::Philips_PCD8544::Command__SetContrast;
+  static const Command_t Command__WriteString = ::Philips_PCD8544::Command__WriteString;
+  static const Command_t Command__SetDisplayMode = ::Philips_PCD8544::Command__SetDisplayMode;
 
-  CommandServer(LCD_t *new_lcd)
-  : lcd(new_lcd)
+  CommandServer(LCD_t *new_lcd, Trace_t *new_trace = NULL)
+  : lcd(new_lcd), trace(new_trace)
   { }
 
 Status::Status_t process(){
   // Packet to process?
   if(! packetPending()) return Status::Status__Good;
+  // Leave packets queued until the display is ready.
+  if(! lcd->initialized()) return Status::Status__Good;
 
   // Data in packet?
   MAP::Data_t *data_ptr = offsetPacket.packet->get_data(offsetPacket.headerOffset);
   if(data_ptr == NULL) return finishedWithPacket();
 
-  DEBUGprint_FORCE("BmS:Oc%d;", *data_ptr);
-
-  // Command 0: Clear screen
-  switch(*data_ptr){
-  // Clear screen
-    case Command__ClearScreen:
-      lcd->clear();
-      lcd->update();
-     break;
-  // Write bitmap
-    case Command__WriteBitmap: {
-      data_ptr++;
-    // First byte is offset. Remaining data is actual image data.
-      // Assumes no more than 254 bitmap bytes per packet.
-      uint8_t packet_size = offsetPacket.packet->back() - data_ptr;
-      // Only proceed if at least one byte is to be written. (Data starts at next byte.)
-      if(packet_size <= 1) break;
-      lcd->writeBitmap(data_ptr + 1, *data_ptr, packet_size - 1);
-      lcd->update();
-     break;
-    }
-  // Read bitmap
-//    case Command__ReadBitmap:
-//     break;
-  // Set contrast
-    case Command__SetContrast: {
-    // First byte is new contrast.
-      data_ptr++;
-      uint8_t packet_size = offsetPacket.packet->back() - data_ptr;
-      if(packet_size > 0)
-        lcd->contrast(*data_ptr);
-      lcd->update();
-     break;
-    }
-  // Write string
-//    case Command__WriteString:
-//     break;
-  // Unrecognized commands are ignored.
-//    default:
-  }
+  if(trace) trace->record(TRACE_COMMAND, data_ptr, offsetPacket.packet->back());
+  handleCommandPacket(lcd, data_ptr, offsetPacket.packet->back());
 
   return finishedWithPacket();
 }
 };
 
 
-/*
-class GalvLCDServer : public SimpleServer {
-  process(){
-    // Packet to process?
-    if(! packetPending()) return;
-
-    // Data in packet?
-    int32_t raw_value;
-    if(! packet->sourceC78Signed(raw_value, packet->get_data())) return;
-    FixedPoint<uint16_t, 14> value(raw_value, true); 
-
-    // Display galvanometer
-    LCDClear();
-    LCDGalvDisplay(value);
-    LCDUpdate();
-  }
+// Definitions, so the aliases can also be bound to references.
+template <typename LCD_t, typename Trace_t> const typename CommandServer<LCD_t, Trace_t>::Command_t CommandServer<LCD_t, Trace_t>::Command__ClearScreen;
+template <typename LCD_t, typename Trace_t> const typename CommandServer<LCD_t, Trace_t>::Command_t CommandServer<LCD_t, Trace_t>::Command__WriteBitmap;
+template <typename LCD_t, typename Trace_t> const typename CommandServer<LCD_t, Trace_t>::Command_t CommandServer<LCD_t, Trace_t>::Command__ReadBitmap;
+template <typename LCD_t, typename Trace_t> const typename CommandServer<LCD_t, Trace_t>::Command_t CommandServer<LCD_t, Trace_t>::Command__SetContrast;
+template <typename LCD_t, typename Trace_t> const typename CommandServer<LCD_t, Trace_t>::Command_t CommandServer<LCD_t, Trace_t>::Command__WriteString;
+template <typename LCD_t, typename Trace_t> const typename CommandServer<LCD_t, Trace_t>::Command_t CommandServer<LCD_t, Trace_t>::Command__SetDisplayMode;
+
+
+// Live view: assembles streamed frames and keeps the bus busy flushing them.
+// See Philips_PCD8544_Stream.hpp for the packet format.
+template <typename LCD_t, typename Trace_t = NullTrace>
+class StreamServer : public SimpleServer, public Process {
+  Trace_t *trace;
+
+public:
+  FrameStream<LCD_t> stream;
+
+  StreamServer(LCD_t *new_lcd, StreamPolicy policy = STREAM_MERGE, Trace_t *new_trace = NULL)
+  : trace(new_trace), stream(new_lcd, policy)
+  { }
+
+Status::Status_t process(){
+  // Send the next bank of the frame being shown.
+  stream.process();
+
+  // Packet to process?
+  if(! packetPending()) return Status::Status__Good;
+
+  // Data in packet?
+  MAP::Data_t *data_ptr = offsetPacket.packet->get_data(offsetPacket.headerOffset);
+  if(data_ptr == NULL) return finishedWithPacket();
+
+  if(trace) trace->record(TRACE_STREAM, data_ptr, offsetPacket.packet->back());
+  stream.write(data_ptr, offsetPacket.packet->back());
+
+  return finishedWithPacket();
+}
+};
+
+
+// Numeric readout (e.g. a galvanometer value). Only the digits that change
+// are redrawn. See handleReadoutPacket for the packet format.
+template <typename LCD_t, typename Readout_t, typename Trace_t = NullTrace>
+class ReadoutServer : public SimpleServer, public Process {
+  LCD_t *lcd;
+  Readout_t *readout;
+  Trace_t *trace;
+
+public:
+  ReadoutServer(LCD_t *new_lcd, Readout_t *new_readout, Trace_t *new_trace = NULL)
+  : lcd(new_lcd), readout(new_readout), trace(new_trace)
+  { }
+
+Status::Status_t process(){
+  // Packet to process?
+  if(! packetPending()) return Status::Status__Good;
+  // Leave packets queued until the display is ready.
+  if(! lcd->initialized()) return Status::Status__Good;
+
+  // Data in packet?
+  MAP::Data_t *data_ptr = offsetPacket.packet->get_data(offsetPacket.headerOffset);
+  if(data_ptr == NULL) return finishedWithPacket();
+
+  if(trace) trace->record(TRACE_READOUT, data_ptr, offsetPacket.packet->back());
+  handleReadoutPacket(readout, data_ptr, offsetPacket.packet->back());
+
+  return finishedWithPacket();
+}
 };
-*/
 
 // End namespace: Philips_PCD8544
 }
@@ -0,0 +1,133 @@
+// Philips PCD8544 graphic LCD driver (C++).
+// Licensed under GPLv3. See license.txt or <http://www.gnu.org/licenses/>.
+
+// Continuous frame streaming (live view).
+//
+// Frames arrive as a sequence of packets, each holding a 16-bit big-endian
+// cache offset followed by frame bytes in cache layout. A frame is complete
+// when a packet reaches the end of the screen. Frames are assembled into a
+// back buffer while the previous complete frame is flushed from the front
+// buffer, a bank per step, so a frame is never shown half-written.
+//
+// Streaming writes display RAM directly; screenCache is left untouched and
+// should be redrawn (clear() and update()) when streaming stops.
+
+#pragma once
+
+namespace Philips_PCD8544 {
+
+// What to do when a frame completes while the previous one is still
+// waiting for the bus.
+typedef enum {
+    STREAM_DROP  = 0,   /* Discard new frames until the waiting one is shown. */
+    STREAM_MERGE = 1    /* Write new frames over the waiting one; the newest is shown. */
+} StreamPolicy;
+
+template <typename LCD_t>
+class FrameStream {
+  static const CacheIndex_t FRAME_SIZE = LCD_t::CACHE_SIZE;
+
+  LCD_t *lcd;
+  byte frames[2][ FRAME_SIZE ];
+  byte *front;
+  byte *back;
+
+/* Next front buffer byte to send; FRAME_SIZE when the front is idle. */
+  CacheIndex_t flushIdx;
+/* Back buffer holds a complete frame, waiting for the front to go idle. */
+  bool pending;
+/* Discarding the remainder of a dropped frame. */
+  bool dropping;
+
+  void present(){
+    if(! pending || flushIdx < FRAME_SIZE) return;
+    byte *tmp = front;
+    front = back;
+    back = tmp;
+    pending = false;
+    flushIdx = 0;
+    framesShown++;
+  }
+
+public:
+  StreamPolicy policy;
+
+  // Statistics.
+  uint16_t framesShown;
+  uint16_t framesDropped;
+  uint16_t framesMerged;
+
+  // A frame is being sent / a complete frame is waiting to be sent.
+  bool flushing() const { return flushIdx < FRAME_SIZE; }
+  bool framePending() const { return pending; }
+
+  FrameStream(LCD_t *new_lcd, StreamPolicy new_policy = STREAM_MERGE)
+  : lcd(new_lcd), front(frames[0]), back(frames[1]), flushIdx(FRAME_SIZE), pending(false), dropping(false),
+    policy(new_policy), framesShown(0), framesDropped(0), framesMerged(0)
+  { }
+
+/*
+ * Name         :  write
+ * Description  :  Accepts one stream packet into the back buffer.
+ * Argument(s)  :  data_ptr -> First byte of packet data (offset high byte).
+ *                 end_ptr  -> One past the last byte of packet data.
+ * Return value :  None.
+ */
+  void write(const uint8_t *data_ptr, const uint8_t *end_ptr){
+    if(end_ptr - data_ptr < 2) return;
+    CacheIndex_t offset = (data_ptr[0] << 8) | data_ptr[1];
+    data_ptr += 2;
+    if(offset >= FRAME_SIZE) return;
+
+    CacheIndex_t size = end_ptr - data_ptr;
+    if(size > FRAME_SIZE - offset) size = FRAME_SIZE - offset;
+    bool last = (offset + size == FRAME_SIZE);
+
+    if(pending){
+      // The bus has not caught up.
+      if(policy == STREAM_DROP){
+        dropping = true;
+      }else{
+        pending = false;
+        framesMerged++;
+      }
+    }
+
+    if(dropping){
+      if(last){
+        dropping = false;
+        framesDropped++;
+      }
+      return;
+    }
+
+    memcpy(back + offset, data_ptr, size);
+    if(last){
+      pending = true;
+      present();
+    }
+  }
+
+/*
+ * Name         :  process
+ * Description  :  Sends the next bank of the front frame, if any.
+ * Argument(s)  :  None.
+ * Return value :  true if a frame is still being sent.
+ */
+  bool process(){
+    if(flushIdx >= FRAME_SIZE || ! lcd->initialized()) return false;
+
+    CacheIndex_t size = LCD_t::BANK_SIZE;
+    if(size > FRAME_SIZE - flushIdx) size = FRAME_SIZE - flushIdx;
+    lcd->writeDirect(front + flushIdx, flushIdx, size);
+    flushIdx += size;
+
+    // Done; show the waiting frame, if there is one.
+    present();
+    return flushIdx < FRAME_SIZE;
+  }
+};
+
+// End namespace: Philips_PCD8544
+}
+
@@ -0,0 +1,156 @@
+// Philips PCD8544 graphic LCD driver (C++).
+// Licensed under GPLv3. See license.txt or <http://www.gnu.org/licenses/>.
+
+// Packet trace capture.
+//
+// A trace is the timestamped packet stream reaching the servers, recorded
+// so that it can be replayed off-target (see tools/pcd8544_replay.cpp).
+//
+// Format (all multi-byte integers little-endian):
+//   Header: 'P' 'C' 'D' 'T', version (1 byte), microseconds per tick (2 bytes)
+//   Record: stream (1 byte), ticks since previous record (varint),
+//           data length (varint), data
+// Varints are LEB128: 7 bits per byte, least significant first, high bit
+// set on all but the last byte.
+
+#pragma once
+
+namespace Philips_PCD8544 {
+
+static const uint8_t TRACE_VERSION = 1;
+
+// Stream identifiers, one per server.
+typedef uint8_t TraceStream_t;
+static const TraceStream_t TRACE_STRING  = 0;
+static const TraceStream_t TRACE_COMMAND = 1;
+static const TraceStream_t TRACE_STREAM  = 2;
+static const TraceStream_t TRACE_READOUT = 3;
+
+// Default trace type for servers: records nothing.
+class NullTrace {
+public:
+  void record(TraceStream_t, const uint8_t *, const uint8_t *){ }
+};
+
+/*
+ * Name         :  TraceRecorder
+ * Description  :  Writes a trace to Sink_t, which must provide put(uint8_t).
+ *                 Timestamps come from Clock_t (interface as in
+ *                 Philips_PCD8544.hpp), which must be a free-running,
+ *                 timer-backed clock reading real time; the AVR
+ *                 DefaultClock only counts its own calls and would make
+ *                 replay latencies meaningless. Timestamps are deltas
+ *                 modulo the range of Clock_t::Time_t, so long captures
+ *                 need a clock that does not wrap between packets.
+ *                 One recorder may be shared by several servers.
+ */
+template <typename Sink_t, typename Clock_t>
+class TraceRecorder {
+  Sink_t *sink;
+  Clock_t clock;
+  typename Clock_t::Time_t lastTime;
+  bool started;
+
+  void putVarint(uint32_t value){
+    while(value >= 0x80){
+      sink->put((value & 0x7F) | 0x80);
+      value >>= 7;
+    }
+    sink->put(value);
+  }
+
+public:
+  TraceRecorder(Sink_t *new_sink)
+  : sink(new_sink), started(false)
+  { }
+  TraceRecorder(Sink_t *new_sink, Clock_t &new_clock)
+  : sink(new_sink), clock(new_clock), started(false)
+  { }
+
+  void record(TraceStream_t stream, const uint8_t *data_ptr, const uint8_t *end_ptr){
+    typename Clock_t::Time_t now = clock.now();
+
+    if(! started){
+      sink->put('P'); sink->put('C'); sink->put('D'); sink->put('T');
+      sink->put(TRACE_VERSION);
+      sink->put(Clock_t::TICK_US & 0xFF);
+      sink->put(Clock_t::TICK_US >> 8);
+      lastTime = now;
+      started = true;
+    }
+
+    sink->put(stream);
+    putVarint((typename Clock_t::Time_t) (now - lastTime));
+    putVarint(end_ptr - data_ptr);
+    while(data_ptr < end_ptr)
+      sink->put(*data_ptr++);
+
+    lastTime = now;
+  }
+};
+
+/*
+ * Name         :  TraceReader
+ * Description  :  Reads a trace from Source_t, which must provide
+ *                 bool get(uint8_t&) returning false at end of input.
+ *                 Records longer than MAX_DATA are truncated.
+ */
+template <typename Source_t, uint16_t MAX_DATA = 1024>
+class TraceReader {
+  Source_t *source;
+
+  bool getVarint(uint32_t &value){
+    uint8_t b, shift = 0;
+    value = 0;
+    do {
+      if(! source->get(b) || shift > 28) return false;
+      value |= (uint32_t) (b & 0x7F) << shift;
+      shift += 7;
+    } while(b & 0x80);
+    return true;
+  }
+
+public:
+  // Microseconds per tick, from the header.
+  uint16_t tickUs;
+
+  // Current record.
+  TraceStream_t stream;
+  uint32_t deltaTicks;
+  uint16_t length;
+  uint8_t data[MAX_DATA];
+
+  TraceReader(Source_t *new_source)
+  : source(new_source), tickUs(0)
+  { }
+
+  // Returns false if the header is missing or of another version.
+  bool readHeader(){
+    uint8_t b[7];
+    for(uint8_t i = 0; i < sizeof(b); i++)
+      if(! source->get(b[i])) return false;
+    if(b[0] != 'P' || b[1] != 'C' || b[2] != 'D' || b[3] != 'T' || b[4] != TRACE_VERSION)
+      return false;
+    tickUs = b[5] | (b[6] << 8);
+    return true;
+  }
+
+  // Returns false at end of trace (or on a truncated record).
+  bool next(){
+    uint32_t size;
+    if(! source->get(stream)) return false;
+    if(! getVarint(deltaTicks)) return false;
+    if(! getVarint(size)) return false;
+    length = 0;
+    for(uint32_t i = 0; i < size; i++){
+      uint8_t b;
+      if(! source->get(b)) return false;
+      if(length < MAX_DATA) data[length++] = b;
+    }
+    return true;
+  }
+};
+
+// End namespace: Philips_PCD8544
+}
+
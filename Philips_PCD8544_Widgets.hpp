@@ -0,0 +1,291 @@
+// Philips PCD8544 graphic LCD driver (C++).
+// Licensed under GPLv3. See license.txt or <http://www.gnu.org/licenses/>.
+
+// Retained-mode widgets. Each remembers what it last drew, so that new
+// data only touches (and marks for update) the pixels that change.
+
+#pragma once
+
+namespace Philips_PCD8544 {
+
+/*
+ * Name         :  BarGraph
+ * Description  :  Row of vertical bars growing upwards from a baseline.
+ *                 A new height fills or clears only the rows between the
+ *                 old and new heights. Assumes nothing else draws over the
+ *                 bars; call reset() after clearing the screen.
+ * Argument(s)  :  baseX     -> x coordinate of the left edge of bar 0.
+ *                 baseY     -> y coordinate just below the bars.
+ *                 barWidth  -> Width of each bar (in pixels).
+ *                 spacing   -> Gap between bars (in pixels).
+ *                 maxHeight -> Heights are clipped to this (and to baseY).
+ */
+template <typename LCD_t, uint8_t MAX_BARS>
+class BarGraph {
+  LCD_t *lcd;
+  // Height of each bar, as drawn.
+  byte heights[ MAX_BARS ];
+
+public:
+  byte baseX, baseY, barWidth, spacing, maxHeight;
+
+  BarGraph(LCD_t *new_lcd, byte new_baseX, byte new_baseY, byte new_barWidth, byte new_spacing, byte new_maxHeight)
+  : lcd(new_lcd), baseX(new_baseX), baseY(new_baseY), barWidth(new_barWidth), spacing(new_spacing), maxHeight(new_maxHeight)
+  { reset(); }
+
+  // Forget what was drawn (e.g. after lcd->clear()).
+  void reset(){ memset(heights, 0, MAX_BARS); }
+
+/*
+ * Name         :  set
+ * Description  :  Sets the height of one bar.
+ * Argument(s)  :  bar    -> Bar index.
+ *                 height -> New height (in pixels).
+ * Return value :  see return value on pcd8544.h
+ */
+  byte set(byte bar, byte height){
+    if(bar >= MAX_BARS) return OUT_OF_BORDER;
+
+    if(height > maxHeight) height = maxHeight;
+    if(height > baseY) height = baseY;
+
+    byte old = heights[bar];
+    if(height == old) return OK;
+
+    byte x = baseX + bar * (barWidth + spacing);
+    byte response;
+    if(height > old)
+      response = lcd->rect(x, x + barWidth, baseY - height, baseY - old, PIXEL_ON);
+    else
+      response = lcd->rect(x, x + barWidth, baseY - old, baseY - height, PIXEL_OFF);
+    if(response) return response;
+
+    heights[bar] = height;
+    return OK;
+  }
+
+/*
+ * Name         :  setAll
+ * Description  :  Sets the heights of the first count bars.
+ * Argument(s)  :  data[]     -> New heights.
+ *                 count      -> Number of bars.
+ *                 multiplier -> Scale applied to each height.
+ * Return value :  see return value on pcd8544.h
+ */
+  byte setAll(const byte data[], byte count, byte multiplier = 1){
+    for(byte bar = 0; bar < count; bar++){
+      uint16_t height = data[bar] * multiplier;
+      byte response = set(bar, height > 0xFF ? 0xFF : height);
+      if(response) return response;
+    }
+    return OK;
+  }
+};
+
+/*
+ * Name         :  NumericReadout
+ * Description  :  Right-aligned number in CELLS character cells, formatted
+ *                 straight into glyphs (no printf or intermediate string).
+ *                 Only cells whose character changes are redrawn, and each
+ *                 run of changed cells is flushed as soon as it is drawn.
+ *                 Values that do not fit are shown as '*'.
+ * Argument(s)  :  x, y     -> Position of the leftmost cell, as gotoXYFont.
+ *                             FONT_2X cells extend into the row above y.
+ *                 size     -> Font size. See enum.
+ *                 decimals -> Digits after the decimal point.
+ */
+template <typename LCD_t, uint8_t CELLS>
+class NumericReadout {
+  LCD_t *lcd;
+  // Characters on display; 0 where unknown.
+  byte shown[ CELLS ];
+  byte text[ CELLS ];
+
+  // Format into text: sign, units, then decimals digits of fraction.
+  void format(bool negative, uint32_t units, uint32_t fraction){
+    int8_t cell = CELLS - 1;
+    byte digits;
+    bool point = false, whole = false;
+
+    for(digits = 0; digits < decimals && cell >= 0; digits++){
+      text[cell--] = '0' + fraction % 10;
+      fraction /= 10;
+    }
+    if(decimals && cell >= 0){
+      text[cell--] = '.';
+      point = true;
+    }
+    while(cell >= 0){
+      text[cell--] = '0' + units % 10;
+      units /= 10;
+      whole = true;
+      if(! units) break;
+    }
+    if(negative && cell >= 0) text[cell--] = '-';
+
+    // At least one units digit, and the point whenever there are decimals.
+    if(units || ! whole || (decimals && ! point) ||
+       (negative && text[cell + 1] != '-') || digits < decimals){
+      // Overflow.
+      memset(text, '*', CELLS);
+      return;
+    }
+    while(cell >= 0) text[cell--] = ' ';
+  }
+
+  // Redraw the cells that differ from what is shown.
+  byte draw(){
+    byte cell = 0, response;
+    while(cell < CELLS){
+      if(text[cell] == shown[cell]){ cell++; continue; }
+
+      response = lcd->gotoXYFont(x + cell * size, y);
+      if(response) return response;
+      while(cell < CELLS && text[cell] != shown[cell]){
+        response = lcd->chr(size, text[cell]);
+        if(response == OUT_OF_BORDER) return response;
+        shown[cell] = text[cell];
+        cell++;
+      }
+      lcd->update();
+    }
+    return OK;
+  }
+
+  static uint32_t power10(byte exponent){
+    uint32_t result = 1;
+    while(exponent--) result *= 10;
+    return result;
+  }
+
+public:
+  byte x, y;
+  LcdFontSize size;
+  byte decimals;
+
+  NumericReadout(LCD_t *new_lcd, byte new_x, byte new_y, LcdFontSize new_size = FONT_1X, byte new_decimals = 0)
+  : lcd(new_lcd), x(new_x), y(new_y), size(new_size), decimals(new_decimals)
+  { reset(); }
+
+  // Forget what is shown (e.g. after lcd->clear()), so the next value redraws every cell.
+  void reset(){ memset(shown, 0, CELLS); }
+
+/*
+ * Name         :  show
+ * Description  :  Displays an integer count of 10^-decimals units
+ *                 (e.g. 1234 with 2 decimals shows 12.34).
+ * Argument(s)  :  value -> Value to display.
+ * Return value :  see return value on pcd8544.h
+ */
+  byte show(int32_t value){
+    uint32_t magnitude = value < 0 ? - (uint32_t) value : value;
+    uint32_t scale = power10(decimals);
+    format(value < 0, magnitude / scale, magnitude % scale);
+    return draw();
+  }
+
+/*
+ * Name         :  showFixed
+ * Description  :  Displays a binary fixed-point value, rounded to
+ *                 decimals digits after the point.
+ * Argument(s)  :  raw          -> Value times 2^fractionBits.
+ *                 fractionBits -> Binary digits after the point.
+ * Return value :  see return value on pcd8544.h
+ */
+  byte showFixed(int32_t raw, byte fractionBits){
+    uint32_t magnitude = raw < 0 ? - (uint32_t) raw : raw;
+    if(fractionBits > 31) fractionBits = 31;
+    uint32_t units = magnitude >> fractionBits;
+    uint32_t fraction = magnitude & (((uint32_t) 1 << fractionBits) - 1);
+
+    // Keep fraction * 10^decimals within 32 bits.
+    if(fractionBits > 16){
+      fraction >>= fractionBits - 16;
+      fractionBits = 16;
+    }
+    uint32_t scale = power10(decimals);
+    if(fractionBits)
+      fraction = (fraction * scale + ((uint32_t) 1 << (fractionBits - 1))) >> fractionBits;
+    if(fraction >= scale){
+      // Rounded up into the units.
+      fraction -= scale;
+      units++;
+    }
+
+    format(raw < 0 && (units || fraction), units, fraction);
+    return draw();
+  }
+};
+
+/*
+ * Name         :  Console
+ * Description  :  Log-style text surface in FONT_1X. Text is appended at
+ *                 the cursor, wrapping at the right edge; a new line at the
+ *                 bottom of the screen scrolls up by one text row (see
+ *                 scrollBanks), so earlier lines are never redrawn. The
+ *                 scroll is deferred until the next character, so the last
+ *                 line stays in view. Needs the full screen cache.
+ */
+template <typename LCD_t>
+class Console {
+  LCD_t *lcd;
+  // Text position of the next character. Past the last row when a scroll is pending.
+  byte column, row;
+
+public:
+  Console(LCD_t *new_lcd)
+  : lcd(new_lcd)
+  { home(); }
+
+  // Continue from the top left (e.g. after lcd->clear()).
+  void home(){ column = row = 1; }
+
+/*
+ * Name         :  write
+ * Description  :  Appends one character; '\n' starts a new line. The
+ *                 display is not updated.
+ * Argument(s)  :  ch -> Character to write.
+ * Return value :  see return value on pcd8544.h
+ */
+  byte write(byte ch){
+    byte response;
+    if(ch == '\n' || column > LCD_t::MAX_X_FONT){
+      response = scrollIfPending();
+      if(response) return response;
+      column = 1;
+      row++;
+      if(ch == '\n') return OK;
+    }
+    response = scrollIfPending();
+    if(response) return response;
+    lcd->gotoXYFont(column++, row);
+    lcd->chr(FONT_1X, ch);
+    return OK;
+  }
+
+/*
+ * Name         :  print
+ * Description  :  Appends a string and updates the display.
+ * Argument(s)  :  text -> NUL-terminated string.
+ * Return value :  see return value on pcd8544.h
+ */
+  byte print(const char *text){
+    byte response = OK;
+    while(*text && response == OK) response = write(*text++);
+    lcd->update();
+    return response;
+  }
+
+private:
+  // Make room at the bottom for a line left pending by the last new line.
+  byte scrollIfPending(){
+    if(row <= LCD_t::MAX_Y_FONT) return OK;
+    byte response = lcd->scrollBanks(1);
+    if(response == OK) row = LCD_t::MAX_Y_FONT;
+    return response;
+  }
+};
+
+// End namespace: Philips_PCD8544
+}
+
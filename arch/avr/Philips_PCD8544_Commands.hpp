@@ -0,0 +1 @@
+../../Philips_PCD8544_Commands.hpp
\ No newline at end of file
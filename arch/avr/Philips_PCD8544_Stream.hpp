@@ -0,0 +1 @@
+../../Philips_PCD8544_Stream.hpp
\ No newline at end of file
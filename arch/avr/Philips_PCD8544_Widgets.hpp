@@ -0,0 +1 @@
+../../Philips_PCD8544_Widgets.hpp
\ No newline at end of file
@@ -1,18 +1,37 @@
 
 #pragma once
 
+#include <util/delay.h>
+
 namespace Philips_PCD8544 {
 
 /*
- * Name         :  Delay
- * Description  :  Uncalibrated delay for LCD init routine.
- * Argument(s)  :  None.
- * Return value :  None.
+ * Name         :  DefaultClock
+ * Description  :  Software clock for the LCD init routine, for systems
+ *                 without a spare timer. Each now() call busy-waits one
+ *                 calibrated (F_CPU-based) tick, so measured intervals are
+ *                 never shorter than real time. It only bounds delays from
+ *                 below: it does not advance between calls, so it cannot
+ *                 timestamp events (e.g. for TraceRecorder). Systems with a
+ *                 timer should supply their own Clock_t.
  */
-inline static void Delay ( void ) {
-    for ( int16_t i = -32000; i < 32000; i++ ) nop();
-}
+class DefaultClock {
+public:
+  typedef uint16_t Time_t;
+  static const uint16_t TICK_US = 10;
+
+  DefaultClock()
+  : ticks(0)
+  { }
+
+  Time_t now(){
+    _delay_us(TICK_US);
+    return ++ticks;
+  }
+
+private:
+  Time_t ticks;
+};
 
 // End namespace: Philips_PCD8544
 }
-
@@ -0,0 +1,29 @@
+
+// Host (POSIX) architecture, for off-target tools and simulation.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Program memory is ordinary memory on the host.
+#ifndef PROGMEM
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *) (address))
+#define memcpy_P memcpy
+#endif
+
+#ifndef TRUE
+#define TRUE true
+#define FALSE false
+#endif
+
+#ifndef DEBUGprint_FORCE
+#define DEBUGprint_FORCE(...)
+#endif
+#ifndef DEBUGprint_MISC
+#define DEBUGprint_MISC(...)
+#endif
+
+#include "time.hpp"
+#include "../../Philips_PCD8544.hpp"
+
@@ -0,0 +1,194 @@
+// Philips PCD8544 graphic LCD driver (C++).
+// Licensed under GPLv3. See license.txt or <http://www.gnu.org/licenses/>.
+
+// Multi-threaded front end for hosts (C++11).
+//
+// Renderer threads each draw into a private Surface (a driver with no bus)
+// and publish its dirty spans through their own single-producer,
+// single-consumer SpanQueue. One BusThread per display drains the queues
+// and owns all SPI traffic. Drawing takes no locks; the queues are
+// lock-free. Renderers sharing a display should draw disjoint regions, as
+// spans from different queues are applied in no particular order.
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+namespace Philips_PCD8544 {
+
+// Hardware stand-ins for surfaces that are never connected to a display.
+class NullBus {
+public:
+  uint8_t transceive(uint8_t){ return 0; }
+};
+
+class NullPin {
+public:
+  void set_output_high(){ }
+  void set_output_low(){ }
+};
+
+/*
+ * Name         :  SpanQueue
+ * Description  :  Lock-free ring of dirty spans from one producer thread to
+ *                 one consumer thread. Each span is at most MAX_SPAN bytes
+ *                 (one bank of the display).
+ */
+template <int MAX_SPAN, unsigned CAPACITY = 64>
+class SpanQueue {
+  // The counters wrap at 2^32; slots stay in sequence only if CAPACITY divides that.
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0 && CAPACITY != 0, "SpanQueue CAPACITY must be a power of two");
+
+public:
+  struct Span {
+    CacheIndex_t offset;
+    uint8_t size;
+    uint8_t data[ MAX_SPAN ];
+  };
+
+private:
+  Span ring[ CAPACITY ];
+  // Free-running counts; the producer owns head and the consumer tail.
+  std::atomic<unsigned> head, tail;
+
+public:
+  SpanQueue() : head(0), tail(0) { }
+
+  // Producer side.
+  unsigned space(){ return CAPACITY - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire)); }
+  // Slot for the next span; only valid when space() is non-zero.
+  Span &back(){ return ring[ head.load(std::memory_order_relaxed) % CAPACITY ]; }
+  void push(){ head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Consumer side.
+  // Oldest span, or NULL when empty.
+  const Span *front(){
+    unsigned t = tail.load(std::memory_order_relaxed);
+    if(t == head.load(std::memory_order_acquire)) return NULL;
+    return &ring[ t % CAPACITY ];
+  }
+  void pop(){ tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+};
+
+/*
+ * Name         :  Renderer
+ * Description  :  Producer side: a private drawing surface and its queue.
+ *                 Draw on surface with the usual driver calls (but not
+ *                 update()), then publish(). Use from one thread only.
+ */
+template <typename LCD_t, unsigned CAPACITY = 64>
+class Renderer {
+public:
+  typedef ::Philips_PCD8544::Philips_PCD8544<NullBus, NullPin, NullPin, NullPin, LCD_t::BANK_SIZE, LCD_t::BANKS * 8> Surface_t;
+  typedef SpanQueue<LCD_t::BANK_SIZE, CAPACITY> Queue_t;
+
+  Surface_t surface;
+  Queue_t queue;
+
+  Renderer(){ surface.init(); }
+
+/*
+ * Name         :  publish
+ * Description  :  Queues the spans drawn since the last publish. If the
+ *                 queue cannot take a whole screen of spans, nothing is
+ *                 queued and the changes stay pending, to be merged with
+ *                 later drawing and published next time.
+ * Argument(s)  :  None.
+ * Return value :  Whether the spans were queued.
+ */
+  bool publish(){
+    if(queue.space() < LCD_t::BANKS) return false;
+    surface.collectDirty(&Renderer::enqueue, this);
+    return true;
+  }
+
+  // Queue the whole surface, e.g. for the first frame.
+  bool publishFrame(){
+    surface.setMinimumWaterMarks(0, LCD_t::CACHE_SIZE - 1);
+    return publish();
+  }
+
+private:
+  static void enqueue(void *context, CacheIndex_t offset, const byte *data, byte size){
+    Queue_t &queue = static_cast<Renderer *>(context)->queue;
+    typename Queue_t::Span &span = queue.back();
+    span.offset = offset;
+    span.size = size;
+    memcpy(span.data, data, size);
+    queue.push();
+  }
+};
+
+/*
+ * Name         :  BusThread
+ * Description  :  Consumer side: owns a display and drains the queues of
+ *                 up to MAX_QUEUES renderers into it, round robin. Spans are
+ *                 written through, so the display's own cache stays current.
+ */
+template <typename LCD_t, typename Queue_t, int MAX_QUEUES = 4>
+class BusThread {
+  LCD_t *lcd;
+  Queue_t *queues[ MAX_QUEUES ];
+  int queueCount;
+  std::atomic<bool> running;
+  std::thread thread;
+
+  void run(){
+    lcd->init();
+    for(;;){
+      // Spans published before stop() are visible once it is seen.
+      bool stopping = ! running.load(std::memory_order_acquire);
+      if(drain()) continue;
+      if(stopping) break;
+      std::this_thread::yield();
+    }
+  }
+
+public:
+  BusThread(LCD_t *new_lcd)
+  : lcd(new_lcd), queueCount(0), running(false)
+  { }
+  ~BusThread(){ stop(); }
+
+  // Add a renderer's queue. Before start() only.
+  bool attach(Queue_t *queue){
+    if(queueCount == MAX_QUEUES) return false;
+    queues[ queueCount++ ] = queue;
+    return true;
+  }
+
+  // Initializes the display, then drains until stop().
+  void start(){
+    running.store(true, std::memory_order_release);
+    thread = std::thread(&BusThread::run, this);
+  }
+
+  // Drains what is queued, then joins the thread.
+  void stop(){
+    running.store(false, std::memory_order_release);
+    if(thread.joinable()) thread.join();
+  }
+
+/*
+ * Name         :  drain
+ * Description  :  Sends at most one span from each queue. Called by the
+ *                 bus thread; may be called directly when not started.
+ * Argument(s)  :  None.
+ * Return value :  Whether anything was sent.
+ */
+  bool drain(){
+    bool sent = false;
+    for(int i = 0; i < queueCount; i++){
+      const typename Queue_t::Span *span = queues[ i ]->front();
+      if(span == NULL) continue;
+      lcd->writeThrough(span->data, span->offset, span->size);
+      queues[ i ]->pop();
+      sent = true;
+    }
+    return sent;
+  }
+};
+
+// End namespace: Philips_PCD8544
+}
@@ -0,0 +1,188 @@
+
+// Simulated PCD8544 controller, for running the driver on a host.
+// SimBus, SimDCPin, SimCEPin and SimRSTPin stand in for the SPI bus and
+// pins; SimClock follows the simulated time, which advances with SPI traffic.
+
+#pragma once
+
+namespace Philips_PCD8544 {
+
+class SimPanel {
+public:
+  static const uint8_t COLUMNS = 84;
+  static const uint8_t BANKS   = 6;
+
+  uint8_t ddram[BANKS][COLUMNS];
+
+  // Controller registers.
+  bool powerDown, vertical, extended;
+  uint8_t displayControl;
+  uint8_t x, y;
+  uint8_t vop, tempCoeff, bias;
+
+  // Interface state.
+  bool selected, dataMode, inReset;
+
+  // Traffic counters.
+  uint32_t commandBytes, dataBytes;
+  uint32_t bursts, dataBursts;
+
+  // Simulated time, and SPI clock rate (bits per second).
+  uint64_t timeNs;
+  uint32_t spiHz;
+
+  SimPanel(uint32_t new_spiHz = 4000000)
+  : selected(false), dataMode(false), inReset(false), timeNs(0), spiHz(new_spiHz)
+  {
+    memset(ddram, 0, sizeof(ddram));
+    reset();
+    resetCounters();
+  }
+
+  // Register values after a reset (RAM is undefined; it is left as is).
+  void reset(){
+    powerDown = true;
+    vertical = extended = false;
+    displayControl = 0;
+    x = y = 0;
+    vop = tempCoeff = bias = 0;
+  }
+
+  void resetCounters(){
+    commandBytes = dataBytes = bursts = dataBursts = 0;
+  }
+
+  void setReset(bool low){
+    if(low) reset();
+    inReset = low;
+  }
+
+  void select(bool low){
+    if(low && ! selected){
+      bursts++;
+      burstHasData = false;
+    }
+    selected = low;
+  }
+
+  void receive(uint8_t b){
+    timeNs += 8000000000ULL / spiHz;
+    if(! selected || inReset) return;
+
+    if(dataMode){
+      dataBytes++;
+      if(! burstHasData){
+        dataBursts++;
+        burstHasData = true;
+      }
+      write(b);
+    }else{
+      commandBytes++;
+      command(b);
+    }
+  }
+
+  // Pixel byte as seen on the glass, after power-down and display control.
+  uint8_t visible(uint8_t bank, uint8_t column){
+    if(powerDown) return 0x00;
+    switch(displayControl){
+      case 0x01: return 0xFF;                        // All segments on
+      case 0x04: return ddram[bank][column];         // Normal
+      case 0x05: return ~ddram[bank][column];        // Inverse
+      default:   return 0x00;                        // Blank
+    }
+  }
+
+  // FNV-1a hashes of display RAM and of the visible image.
+  uint32_t ddramChecksum(){
+    uint32_t hash = 2166136261UL;
+    for(uint8_t bank = 0; bank < BANKS; bank++)
+      for(uint8_t column = 0; column < COLUMNS; column++)
+        hash = (hash ^ ddram[bank][column]) * 16777619UL;
+    return hash;
+  }
+  uint32_t visibleChecksum(){
+    uint32_t hash = 2166136261UL;
+    for(uint8_t bank = 0; bank < BANKS; bank++)
+      for(uint8_t column = 0; column < COLUMNS; column++)
+        hash = (hash ^ visible(bank, column)) * 16777619UL;
+    return hash;
+  }
+
+private:
+  bool burstHasData;
+
+  void write(uint8_t b){
+    if(x < COLUMNS && y < BANKS) ddram[y][x] = b;
+    if(vertical){
+      if(++y >= BANKS){ y = 0; if(++x >= COLUMNS) x = 0; }
+    }else{
+      if(++x >= COLUMNS){ x = 0; if(++y >= BANKS) y = 0; }
+    }
+  }
+
+  void command(uint8_t b){
+    if((b & 0xF8) == 0x20){
+      powerDown = b & 0x04;
+      vertical  = b & 0x02;
+      extended  = b & 0x01;
+    }else if(extended){
+      if(b & 0x80)                vop = b & 0x7F;
+      else if((b & 0xF8) == 0x10) bias = b & 0x07;
+      else if((b & 0xFC) == 0x04) tempCoeff = b & 0x03;
+    }else{
+      if(b & 0x80)                x = b & 0x7F;
+      else if((b & 0xF8) == 0x40) y = b & 0x07;
+      else if((b & 0xFA) == 0x08) displayControl = b & 0x05;
+    }
+  }
+};
+
+class SimBus {
+  SimPanel *panel;
+public:
+  SimBus(SimPanel *new_panel) : panel(new_panel) { }
+  uint8_t transceive(uint8_t b){ panel->receive(b); return 0; }
+};
+
+class SimDCPin {
+  SimPanel *panel;
+public:
+  SimDCPin(SimPanel *new_panel) : panel(new_panel) { }
+  void set_output_high(){ panel->dataMode = true; }
+  void set_output_low(){ panel->dataMode = false; }
+};
+
+class SimCEPin {
+  SimPanel *panel;
+public:
+  SimCEPin(SimPanel *new_panel) : panel(new_panel) { }
+  void set_output_high(){ panel->select(false); }
+  void set_output_low(){ panel->select(true); }
+};
+
+class SimRSTPin {
+  SimPanel *panel;
+public:
+  SimRSTPin(SimPanel *new_panel) : panel(new_panel) { }
+  void set_output_high(){ panel->setReset(false); }
+  void set_output_low(){ panel->setReset(true); }
+};
+
+// Each reading costs one microsecond, so that polling loops terminate.
+class SimClock {
+  SimPanel *panel;
+public:
+  typedef uint32_t Time_t;
+  static const uint16_t TICK_US = 1;
+
+  SimClock(SimPanel *new_panel) : panel(new_panel) { }
+  Time_t now(){
+    panel->timeNs += 1000;
+    return panel->timeNs / 1000;
+  }
+};
+
+// End namespace: Philips_PCD8544
+}
+
@@ -0,0 +1,31 @@
+
+// stdio sink and source for Philips_PCD8544_Trace.hpp.
+
+#pragma once
+
+#include <stdio.h>
+
+namespace Philips_PCD8544 {
+
+class FileTraceSink {
+  FILE *file;
+public:
+  FileTraceSink(FILE *new_file) : file(new_file) { }
+  void put(uint8_t b){ fputc(b, file); }
+};
+
+class FileTraceSource {
+  FILE *file;
+public:
+  FileTraceSource(FILE *new_file) : file(new_file) { }
+  bool get(uint8_t &b){
+    int c = fgetc(file);
+    if(c == EOF) return false;
+    b = c;
+    return true;
+  }
+};
+
+// End namespace: Philips_PCD8544
+}
+
@@ -0,0 +1,26 @@
+
+#pragma once
+
+#include <time.h>
+
+namespace Philips_PCD8544 {
+
+/*
+ * Name         :  DefaultClock
+ * Description  :  Monotonic microsecond clock.
+ */
+class DefaultClock {
+public:
+  typedef uint32_t Time_t;
+  static const uint16_t TICK_US = 1;
+
+  Time_t now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (Time_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  }
+};
+
+// End namespace: Philips_PCD8544
+}
+
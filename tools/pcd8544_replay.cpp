@@ -0,0 +1,207 @@
+// Philips PCD8544 graphic LCD driver (C++).
+// Licensed under GPLv3. See license.txt or <http://www.gnu.org/licenses/>.
+
+// Trace replay benchmark.
+//
+// Feeds a packet trace (see Philips_PCD8544_Trace.hpp) through the server
+// packet handlers into a driver backed by a simulated panel, and reports SPI
+// traffic, latency and checksums of the final frame. Packet latency is the
+// time from a packet's capture timestamp until its SPI traffic ends,
+// counting SPI time only, with packets queued behind earlier ones. Stream
+// packets are only buffered, so streamed frames are timed instead: from the
+// packet that completes a frame until the frame has been sent.
+//
+// Build, from the repository root:
+//   g++ -O2 -o pcd8544_replay tools/pcd8544_replay.cpp arch/host/sbFont.cpp
+// Run:
+//   pcd8544_replay [--spi-hz N] [--stream-policy drop|merge] [--pbm final.pbm]
+//                  [--readout x,y,size,decimals] trace.bin
+//
+// Streamed frames are flushed a bank at a time in the gaps between packets,
+// as StreamServer does, so the drop/merge policy is exercised when the
+// captured frame rate exceeds what the simulated bus sustains.
+//
+// Readout packets go to an 8-cell NumericReadout, placed by --readout as the
+// application placed it (default 1,1,1,0: top left, FONT_1X, no decimals).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+#include "../arch/host/Philips_PCD8544.hpp"
+#include "../arch/host/SimPanel.hpp"
+#include "../arch/host/TraceFile.hpp"
+#include "../Philips_PCD8544_Commands.hpp"
+#include "../Philips_PCD8544_Stream.hpp"
+#include "../Philips_PCD8544_Trace.hpp"
+#include "../Philips_PCD8544_Widgets.hpp"
+
+using namespace Philips_PCD8544;
+
+typedef ::Philips_PCD8544::Philips_PCD8544<SimBus, SimDCPin, SimCEPin, SimRSTPin, 84, 48, SimClock> LCD_t;
+
+static uint64_t percentile(const std::vector<uint64_t> &sorted, unsigned pct){
+  if(sorted.empty()) return 0;
+  size_t i = (sorted.size() * pct + 99) / 100;
+  return sorted[i ? i - 1 : 0];
+}
+
+static void printLatency(const char *label, const std::vector<uint64_t> &sorted){
+  printf("%-11s us p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n", label,
+         percentile(sorted, 50) / 1000.0, percentile(sorted, 90) / 1000.0,
+         percentile(sorted, 99) / 1000.0, percentile(sorted, 100) / 1000.0);
+}
+
+// Sends the next bank of streamed frames. When a frame finishes, records
+// its latency and starts timing the waiting frame, if it was presented.
+static bool streamStep(FrameStream<LCD_t> &stream, SimPanel &panel,
+                       uint64_t &frontReadyNs, uint64_t &backReadyNs, std::vector<uint64_t> &frameLatencies){
+  bool flushing = stream.flushing();
+  uint16_t shown = stream.framesShown;
+  bool more = stream.process();
+  if(flushing && (! stream.flushing() || stream.framesShown != shown))
+    frameLatencies.push_back(panel.timeNs - frontReadyNs);
+  if(stream.framesShown != shown) frontReadyNs = backReadyNs;
+  return more;
+}
+
+static bool writePBM(const char *path, SimPanel &panel){
+  FILE *file = fopen(path, "wb");
+  if(file == NULL) return false;
+  fprintf(file, "P4\n%d %d\n", SimPanel::COLUMNS, SimPanel::BANKS * 8);
+  for(uint8_t y = 0; y < SimPanel::BANKS * 8; y++){
+    uint8_t b = 0;
+    for(uint8_t x = 0; x < SimPanel::COLUMNS; x++){
+      b = (b << 1) | ((panel.visible(y / 8, x) >> (y % 8)) & 1);
+      if((x & 7) == 7) { fputc(b, file); b = 0; }
+    }
+    if(SimPanel::COLUMNS & 7) fputc(b << (8 - (SimPanel::COLUMNS & 7)), file);
+  }
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char **argv){
+  uint32_t spiHz = 4000000;
+  StreamPolicy policy = STREAM_MERGE;
+  const char *pbmPath = NULL;
+  const char *tracePath = NULL;
+  unsigned readoutX = 1, readoutY = 1, readoutSize = FONT_1X, readoutDecimals = 0;
+
+  for(int i = 1; i < argc; i++){
+    if(! strcmp(argv[i], "--spi-hz") && i + 1 < argc) spiHz = strtoul(argv[++i], NULL, 0);
+    else if(! strcmp(argv[i], "--pbm") && i + 1 < argc) pbmPath = argv[++i];
+    else if(! strcmp(argv[i], "--stream-policy") && i + 1 < argc)
+      policy = strcmp(argv[++i], "drop") ? STREAM_MERGE : STREAM_DROP;
+    else if(! strcmp(argv[i], "--readout") && i + 1 < argc){
+      if(sscanf(argv[++i], "%u,%u,%u,%u", &readoutX, &readoutY, &readoutSize, &readoutDecimals) != 4
+         || readoutSize < FONT_1X || readoutSize > FONT_2X)
+        tracePath = NULL, argc = 0;
+    }
+    else if(tracePath == NULL && argv[i][0] != '-') tracePath = argv[i];
+    else tracePath = NULL, argc = 0;
+  }
+  if(tracePath == NULL || spiHz == 0){
+    fprintf(stderr, "usage: %s [--spi-hz N] [--stream-policy drop|merge] [--pbm final.pbm] [--readout x,y,size,decimals] trace.bin\n", argv[0]);
+    return 2;
+  }
+
+  FILE *file = fopen(tracePath, "rb");
+  if(file == NULL){ perror(tracePath); return 1; }
+  FileTraceSource source(file);
+  TraceReader<FileTraceSource> reader(&source);
+  if(! reader.readHeader()){
+    fprintf(stderr, "%s: not a version %d trace\n", tracePath, TRACE_VERSION);
+    return 1;
+  }
+
+  SimPanel panel(spiHz);
+  SimBus bus(&panel);
+  SimDCPin dc(&panel);
+  SimCEPin ce(&panel);
+  SimRSTPin rst(&panel);
+  SimClock clock(&panel);
+  LCD_t lcd(bus, dc, ce, rst, clock);
+  FrameStream<LCD_t> stream(&lcd, policy);
+  NumericReadout<LCD_t, 8> readout(&lcd, readoutX, readoutY, (LcdFontSize) readoutSize, readoutDecimals);
+
+  // Initialization is not part of the workload.
+  lcd.init();
+  panel.resetCounters();
+  panel.timeNs = 0;
+
+  uint32_t counts[256] = { 0 };
+  uint32_t skipped = 0;
+  uint64_t captureUs = 0;
+  std::vector<uint64_t> latencies, frameLatencies;
+  // Capture times of the completing packets of the frame being sent and of
+  // the frame waiting to be sent.
+  uint64_t frontReadyNs = 0, backReadyNs = 0;
+
+  while(reader.next()){
+    captureUs += (uint64_t) reader.deltaTicks * reader.tickUs;
+    uint64_t arrivalNs = captureUs * 1000;
+    // The bus keeps flushing streamed frames until the packet arrives.
+    while(panel.timeNs < arrivalNs && streamStep(stream, panel, frontReadyNs, backReadyNs, frameLatencies));
+    // Packets queue behind SPI traffic for earlier ones.
+    if(panel.timeNs < arrivalNs) panel.timeNs = arrivalNs;
+
+    const uint8_t *data_ptr = reader.data, *end_ptr = reader.data + reader.length;
+    switch(reader.stream){
+      case TRACE_STRING:
+        handleStringPacket(&lcd, data_ptr, end_ptr);
+        break;
+      case TRACE_COMMAND:
+        if(data_ptr == end_ptr) { skipped++; continue; }
+        handleCommandPacket(&lcd, data_ptr, end_ptr);
+        break;
+      case TRACE_STREAM: {
+        uint16_t shown = stream.framesShown;
+        bool pending = stream.framePending();
+        stream.write(data_ptr, end_ptr);
+        if(stream.framesShown != shown) frontReadyNs = arrivalNs;
+        else if(stream.framePending() && ! pending) backReadyNs = arrivalNs;
+        // Not a packet latency; see frameLatencies.
+        counts[TRACE_STREAM]++;
+        continue;
+      }
+      case TRACE_READOUT:
+        handleReadoutPacket(&readout, data_ptr, end_ptr);
+        break;
+      default:
+        skipped++;
+        continue;
+    }
+    counts[reader.stream]++;
+    latencies.push_back(panel.timeNs - arrivalNs);
+  }
+  fclose(file);
+  while(streamStep(stream, panel, frontReadyNs, backReadyNs, frameLatencies));
+
+  std::sort(latencies.begin(), latencies.end());
+  std::sort(frameLatencies.begin(), frameLatencies.end());
+
+  printf("packets        %zu (string %u, command %u, stream %u, readout %u, skipped %u)\n", latencies.size() + counts[TRACE_STREAM],
+         counts[TRACE_STRING], counts[TRACE_COMMAND], counts[TRACE_STREAM], counts[TRACE_READOUT], skipped);
+  if(counts[TRACE_STREAM]){
+    printf("stream frames  shown %u, dropped %u, merged %u\n",
+           stream.framesShown, stream.framesDropped, stream.framesMerged);
+    printLatency("frame latency", frameLatencies);
+  }
+  printf("spi bytes      %u (command %u, data %u)\n",
+         panel.commandBytes + panel.dataBytes, panel.commandBytes, panel.dataBytes);
+  printf("bursts         %u\n", panel.bursts);
+  printf("flushes        %u\n", panel.dataBursts);
+  if(! latencies.empty())
+    printLatency("latency", latencies);
+  printf("ddram fnv1a    0x%08x\n", panel.ddramChecksum());
+  printf("visible fnv1a  0x%08x\n", panel.visibleChecksum());
+
+  if(pbmPath && ! writePBM(pbmPath, panel)){
+    perror(pbmPath);
+    return 1;
+  }
+  return 0;
+}
+
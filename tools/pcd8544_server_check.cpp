@@ -0,0 +1,122 @@
+// Philips PCD8544 graphic LCD driver (C++).
+// Licensed under GPLv3. See license.txt or <http://www.gnu.org/licenses/>.
+
+// Server check.
+//
+// Compiles Philips_PCD8544_Server.hpp on the host, against the Upacket
+// stand-in in tools/stubs, and runs each server against a simulated panel:
+// InitProcess, StringServer (recording a trace), CommandServer, StreamServer
+// and ReadoutServer.
+//
+// Build, from the repository root:
+//   g++ -O2 -Itools/stubs -o pcd8544_server_check tools/pcd8544_server_check.cpp arch/host/sbFont.cpp
+// Run:
+//   pcd8544_server_check
+// Exits with status 1 if any check fails.
+
+#include <stdio.h>
+#include <vector>
+
+#include "../arch/host/Philips_PCD8544.hpp"
+#include "../arch/host/SimPanel.hpp"
+#include "../Philips_PCD8544_Server.hpp"
+
+using namespace Philips_PCD8544;
+
+typedef ::Philips_PCD8544::Philips_PCD8544<SimBus, SimDCPin, SimCEPin, SimRSTPin, 84, 48, SimClock> LCD_t;
+
+// Collects a trace in memory.
+class VectorSink {
+public:
+  std::vector<uint8_t> bytes;
+  void put(uint8_t b){ bytes.push_back(b); }
+};
+
+static unsigned failures = 0;
+
+static void check(bool ok, const char *what){
+  printf("%-44s %s\n", what, ok ? "ok" : "FAIL");
+  if(! ok) failures++;
+}
+
+// Delivers one packet and runs the server until it is consumed.
+template <typename Server_t>
+static bool deliver(Server_t &server, std::vector<uint8_t> data){
+  MAP::MAPPacket packet(&data[0], &data[0] + data.size());
+  if(! server.accept(&packet)) return false;
+  for(int i = 0; i < 1000 && ! server.idle(); i++) server.process();
+  return server.idle();
+}
+
+static bool bankIsBlank(SimPanel &panel, uint8_t bank){
+  for(uint8_t x = 0; x < SimPanel::COLUMNS; x++)
+    if(panel.ddram[bank][x]) return false;
+  return true;
+}
+
+int main(){
+  SimPanel panel;
+  SimBus bus(&panel);
+  SimDCPin dc(&panel);
+  SimCEPin ce(&panel);
+  SimRSTPin rst(&panel);
+  SimClock clock(&panel);
+  LCD_t lcd(bus, dc, ce, rst, clock);
+
+  VectorSink sink;
+  TraceRecorder<VectorSink, SimClock> recorder(&sink, clock);
+  InitProcess<LCD_t> init(&lcd);
+  StringServer<LCD_t, TraceRecorder<VectorSink, SimClock> > strings(&lcd, &recorder);
+  CommandServer<LCD_t> commands(&lcd);
+  StreamServer<LCD_t> streams(&lcd);
+  NumericReadout<LCD_t, 6> readout(&lcd, 1, 6, FONT_1X, 2);
+  ReadoutServer<LCD_t, NumericReadout<LCD_t, 6> > readouts(&lcd, &readout);
+
+  // Packets wait until initialization, which InitProcess steps.
+  std::vector<uint8_t> hello;
+  hello.push_back('H'); hello.push_back('i');
+  MAP::MAPPacket early(&hello[0], &hello[0] + hello.size());
+  strings.accept(&early);
+  strings.process();
+  check(! lcd.initialized() && panel.dataBytes == 0, "StringServer waits for init");
+  for(int i = 0; i < 100 && ! lcd.initialized(); i++) init.process();
+  check(lcd.initialized(), "InitProcess initializes");
+  strings.process();
+  check(! bankIsBlank(panel, 0), "StringServer draws");
+  check(sink.bytes.size() > 5 && sink.bytes[0] == 'P' && sink.bytes[5 + 2] == TRACE_STRING,
+        "StringServer records a trace");
+
+  std::vector<uint8_t> contrast;
+  contrast.push_back(CommandServer<LCD_t>::Command__SetContrast); contrast.push_back(0x30);
+  check(deliver(commands, contrast) && panel.vop == 0x30, "CommandServer sets contrast");
+
+  std::vector<uint8_t> mode;
+  mode.push_back(CommandServer<LCD_t>::Command__SetDisplayMode); mode.push_back(DISPLAY_INVERSE);
+  check(deliver(commands, mode) && lcd.displayMode() == DISPLAY_INVERSE, "CommandServer sets display mode");
+
+  std::vector<uint8_t> clear;
+  clear.push_back(CommandServer<LCD_t>::Command__ClearScreen);
+  check(deliver(commands, clear) && bankIsBlank(panel, 0), "CommandServer clears");
+
+  std::vector<uint8_t> bitmap;
+  bitmap.push_back(CommandServer<LCD_t>::Command__WriteBitmap); bitmap.push_back(10);
+  bitmap.push_back(0xAA); bitmap.push_back(0x55);
+  check(deliver(commands, bitmap) && panel.ddram[0][10] == 0xAA && panel.ddram[0][11] == 0x55,
+        "CommandServer writes a bitmap");
+
+  // One whole frame in a single packet: offset 0, then every byte.
+  std::vector<uint8_t> frame(2 + LCD_t::CACHE_SIZE, 0x81);
+  frame[0] = frame[1] = 0;
+  check(deliver(streams, frame), "StreamServer accepts a frame");
+  for(int i = 0; i < LCD_t::BANKS + 1; i++) streams.process();
+  check(streams.stream.framesShown == 1 && panel.ddram[5][83] == 0x81, "StreamServer shows the frame");
+
+  std::vector<uint8_t> value;
+  value.push_back(0); value.push_back(0x04); value.push_back(0xD2);   // 1234 -> 12.34
+  lcd.clear();
+  lcd.update();
+  check(deliver(readouts, value) && ! bankIsBlank(panel, 5), "ReadoutServer shows a value");
+
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+// Philips PCD8544 graphic LCD driver (C++).
+// Licensed under GPLv3. See license.txt or <http://www.gnu.org/licenses/>.
+
+// Threaded front end check.
+//
+// Three renderer threads each XOR random rectangles into their own third of
+// the screen, publishing after every rectangle, while a BusThread drains
+// their queues into a simulated panel. At the end the panel must match each
+// renderer's surface over its region.
+//
+// Build, from the repository root:
+//   g++ -std=c++11 -O2 -pthread -o pcd8544_threaded_check tools/pcd8544_threaded_check.cpp arch/host/sbFont.cpp
+// Race checking:
+//   add -fsanitize=thread
+// Run:
+//   pcd8544_threaded_check [rectangles per thread]
+// Exits with status 1 on a mismatch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+#include "../arch/host/Philips_PCD8544.hpp"
+#include "../arch/host/SimPanel.hpp"
+#include "../arch/host/Philips_PCD8544_Threaded.hpp"
+
+using namespace Philips_PCD8544;
+
+typedef ::Philips_PCD8544::Philips_PCD8544<SimBus, SimDCPin, SimCEPin, SimRSTPin, 84, 48, SimClock> LCD_t;
+typedef Renderer<LCD_t, 16> Renderer_t;
+
+static const int RENDERERS = 3;
+static const int BANDS_PER_RENDERER = LCD_t::BANKS / RENDERERS;
+
+static void render(Renderer_t *renderer, int index, int rectangles, unsigned *deferred){
+  unsigned seed = index + 1;
+  int top = index * BANDS_PER_RENDERER * 8, rows = BANDS_PER_RENDERER * 8;
+  for(int i = 0; i < rectangles; i++){
+    byte x1 = rand_r(&seed) % LCD_t::BANK_SIZE, x2 = rand_r(&seed) % (LCD_t::BANK_SIZE + 1);
+    byte y1 = top + rand_r(&seed) % rows, y2 = top + rand_r(&seed) % (rows + 1);
+    renderer->surface.rect(x1, x2, y1, y2, PIXEL_XOR);
+    if(! renderer->publish()) (*deferred)++;
+  }
+  while(! renderer->publish()) std::this_thread::yield();
+}
+
+struct Compare {
+  SimPanel *panel;
+  unsigned mismatches;
+};
+
+static void compareSpan(void *context, CacheIndex_t offset, const byte *data, byte size){
+  Compare *compare = static_cast<Compare *>(context);
+  if(memcmp(&compare->panel->ddram[offset / LCD_t::BANK_SIZE][offset % LCD_t::BANK_SIZE], data, size))
+    compare->mismatches++;
+}
+
+int main(int argc, char **argv){
+  int rectangles = argc > 1 ? atoi(argv[1]) : 20000;
+
+  SimPanel panel;
+  SimBus bus(&panel);
+  SimDCPin dc(&panel);
+  SimCEPin ce(&panel);
+  SimRSTPin rst(&panel);
+  SimClock clock(&panel);
+  LCD_t lcd(bus, dc, ce, rst, clock);
+
+  std::vector<Renderer_t> renderers(RENDERERS);
+  BusThread<LCD_t, Renderer_t::Queue_t> busThread(&lcd);
+  for(int i = 0; i < RENDERERS; i++) busThread.attach(&renderers[i].queue);
+  busThread.start();
+
+  unsigned deferred[RENDERERS] = { 0 };
+  std::vector<std::thread> threads;
+  for(int i = 0; i < RENDERERS; i++)
+    threads.push_back(std::thread(render, &renderers[i], i, rectangles, &deferred[i]));
+  for(size_t i = 0; i < threads.size(); i++) threads[i].join();
+  busThread.stop();
+
+  // Compare each renderer's region of the panel with its surface.
+  Compare compare = { &panel, 0 };
+  for(int i = 0; i < RENDERERS; i++){
+    CacheIndex_t first = i * BANDS_PER_RENDERER * LCD_t::BANK_SIZE;
+    renderers[i].surface.setMinimumWaterMarks(first, first + BANDS_PER_RENDERER * LCD_t::BANK_SIZE - 1);
+    renderers[i].surface.collectDirty(compareSpan, &compare);
+  }
+
+  printf("renderers      %d x %d rectangles\n", RENDERERS, rectangles);
+  printf("deferred       %u %u %u publishes\n", deferred[0], deferred[1], deferred[2]);
+  printf("spi bytes      %u (command %u, data %u)\n",
+         panel.commandBytes + panel.dataBytes, panel.commandBytes, panel.dataBytes);
+  printf("mismatches     %u\n", compare.mismatches);
+  return compare.mismatches ? 1 : 0;
+}
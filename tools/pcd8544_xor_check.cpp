@@ -0,0 +1,106 @@
+// Philips PCD8544 graphic LCD driver (C++).
+// Licensed under GPLv3. See license.txt or <http://www.gnu.org/licenses/>.
+
+// Xor mode check.
+//
+// Draws random shapes of each primitive once with PIXEL_ON and once with
+// PIXEL_XOR, each on a blank cache. Xor mode is exact when the two match,
+// i.e. when no pixel of the shape is changed twice. Filled shapes must also
+// cover their outline.
+//
+// Build, from the repository root:
+//   g++ -O2 -o pcd8544_xor_check tools/pcd8544_xor_check.cpp arch/host/sbFont.cpp
+// Run:
+//   pcd8544_xor_check [shapes per primitive]
+// Exits with status 1 on any difference.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../arch/host/Philips_PCD8544.hpp"
+#include "../arch/host/Philips_PCD8544_Threaded.hpp"
+
+using namespace Philips_PCD8544;
+
+typedef ::Philips_PCD8544::Philips_PCD8544<NullBus, NullPin, NullPin, NullPin> LCD_t;
+
+enum { PIXEL, LINE, RECT, CIRCLE, FILL_CIRCLE, ELLIPSE, FILL_ELLIPSE,
+       ARC, FILL_ARC, POLYGON, FILL_POLYGON, PRIMITIVES };
+
+static const char *names[PRIMITIVES] = {
+  "pixel", "line", "rect", "circle", "fillCircle", "ellipse", "fillEllipse",
+  "arc", "fillArc", "polygon", "fillPolygon"
+};
+
+// The outline each filled primitive must cover.
+static const int outlines[PRIMITIVES] = {
+  -1, -1, -1, -1, CIRCLE, -1, ELLIPSE, -1, ARC, -1, POLYGON
+};
+
+struct Shape {
+  byte x[4], y[4], r, ry, count;
+  int16_t start, end;
+};
+
+static Shape randomShape(unsigned *seed){
+  Shape shape;
+  for(int i = 0; i < 4; i++){
+    shape.x[i] = rand_r(seed) % LCD_t::BANK_SIZE;
+    shape.y[i] = rand_r(seed) % (LCD_t::BANKS * 8);
+  }
+  shape.r = rand_r(seed) % 24;
+  shape.ry = rand_r(seed) % 24;
+  shape.count = 1 + rand_r(seed) % 4;
+  shape.start = rand_r(seed) % 720 - 360;
+  shape.end = rand_r(seed) % 720 - 360;
+  return shape;
+}
+
+static void draw(LCD_t &lcd, int primitive, const Shape &s, PixelMode mode){
+  lcd.clear();
+  switch(primitive){
+  case PIXEL:        lcd.pixel(s.x[0], s.y[0], mode); break;
+  case LINE:         lcd.line(s.x[0], s.x[1], s.y[0], s.y[1], mode); break;
+  case RECT:         lcd.rect(s.x[0], s.x[1], s.y[0], s.y[1], mode); break;
+  case CIRCLE:       lcd.circle(s.x[0], s.y[0], s.r, mode); break;
+  case FILL_CIRCLE:  lcd.fillCircle(s.x[0], s.y[0], s.r, mode); break;
+  case ELLIPSE:      lcd.ellipse(s.x[0], s.y[0], s.r, s.ry, mode); break;
+  case FILL_ELLIPSE: lcd.fillEllipse(s.x[0], s.y[0], s.r, s.ry, mode); break;
+  case ARC:          lcd.arc(s.x[0], s.y[0], s.r, s.start, s.end, mode); break;
+  case FILL_ARC:     lcd.fillArc(s.x[0], s.y[0], s.r, s.start, s.end, mode); break;
+  case POLYGON:      lcd.polygon(s.x, s.y, s.count, mode); break;
+  case FILL_POLYGON: lcd.fillPolygon(s.x, s.y, s.count, mode); break;
+  }
+}
+
+int main(int argc, char **argv){
+  int shapes = argc > 1 ? atoi(argv[1]) : 5000;
+  static byte on[LCD_t::CACHE_SIZE], outline[LCD_t::CACHE_SIZE];
+  unsigned failures = 0;
+
+  LCD_t lcd;
+  lcd.init();
+  const byte *cache = lcd.storage().data();
+
+  for(int primitive = 0; primitive < PRIMITIVES; primitive++){
+    unsigned seed = primitive + 1, differ = 0, uncovered = 0;
+    for(int i = 0; i < shapes; i++){
+      Shape shape = randomShape(&seed);
+      draw(lcd, primitive, shape, PIXEL_ON);
+      memcpy(on, cache, LCD_t::CACHE_SIZE);
+      draw(lcd, primitive, shape, PIXEL_XOR);
+      if(memcmp(on, cache, LCD_t::CACHE_SIZE)) differ++;
+      if(outlines[primitive] >= 0){
+        draw(lcd, outlines[primitive], shape, PIXEL_ON);
+        memcpy(outline, cache, LCD_t::CACHE_SIZE);
+        for(int j = 0; j < LCD_t::CACHE_SIZE; j++)
+          if(outline[j] & ~on[j]){ uncovered++; break; }
+      }
+    }
+    printf("%-12s xor differs %5u, outline uncovered %5u of %d\n",
+           names[primitive], differ, uncovered, shapes);
+    failures += differ + uncovered;
+  }
+  return failures ? 1 : 0;
+}
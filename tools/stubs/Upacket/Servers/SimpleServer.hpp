@@ -0,0 +1,68 @@
+// Philips PCD8544 graphic LCD driver (C++).
+// Licensed under GPLv3. See license.txt or <http://www.gnu.org/licenses/>.
+
+// Host stand-in for the parts of Upacket that Philips_PCD8544_Server.hpp
+// uses, so the servers can be compiled and run off-target (see
+// tools/pcd8544_server_check.cpp). Not a Upacket implementation.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Status {
+  typedef enum {
+    Status__Good = 0,
+    Status__Bad  = 1
+  } Status_t;
+}
+
+namespace MAP {
+  typedef uint8_t Data_t;
+
+  // A received packet: header bytes followed by data, ending at back().
+  class MAPPacket {
+    Data_t *begin;
+    Data_t *end;
+  public:
+    MAPPacket(Data_t *new_begin, Data_t *new_end) : begin(new_begin), end(new_end) { }
+    // Data at offset, or NULL when there is none.
+    Data_t *get_data(size_t offset){ return begin + offset < end ? begin + offset : NULL; }
+    Data_t *back(){ return end; }
+  };
+}
+
+class Process {
+public:
+  virtual Status::Status_t process() = 0;
+  virtual ~Process() { }
+};
+
+// Holds at most one packet, delivered with accept().
+class SimpleServer {
+protected:
+  struct {
+    MAP::MAPPacket *packet;
+    size_t headerOffset;
+  } offsetPacket;
+
+  bool packetPending(){ return offsetPacket.packet != NULL; }
+  Status::Status_t finishedWithPacket(){
+    offsetPacket.packet = NULL;
+    return Status::Status__Good;
+  }
+
+public:
+  SimpleServer(){ offsetPacket.packet = NULL; offsetPacket.headerOffset = 0; }
+
+  // Whether the last packet has been processed.
+  bool idle(){ return ! packetPending(); }
+
+  // False if the previous packet has not been processed yet.
+  bool accept(MAP::MAPPacket *packet, size_t headerOffset = 0){
+    if(packetPending()) return false;
+    offsetPacket.packet = packet;
+    offsetPacket.headerOffset = headerOffset;
+    return true;
+  }
+};